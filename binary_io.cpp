@@ -0,0 +1,68 @@
+#include <iostream>
+
+#include "binary_io.h"
+
+namespace game {
+
+BinaryWriter::BinaryWriter(const std::string &path)
+{
+    path_ = path;
+    out_.open(path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (out_.fail()) {
+        throw(std::ios_base::failure(std::string("Error creating file ") + path));
+    }
+}
+
+
+void BinaryWriter::WriteString(const std::string &value)
+{
+    Write<uint32_t>((uint32_t)value.size());
+    out_.write(value.data(), value.size());
+}
+
+
+void BinaryWriter::Close(void)
+{
+    out_.close();
+    if (out_.fail()) {
+        throw(std::ios_base::failure(std::string("Error writing file ") + path_));
+    }
+}
+
+
+BinaryReader::BinaryReader(const std::string &path)
+{
+    path_ = path;
+    in_.open(path.c_str(), std::ios::in | std::ios::binary);
+    if (in_.fail()) {
+        throw(std::ios_base::failure(std::string("Error opening file ") + path));
+    }
+}
+
+
+std::string BinaryReader::ReadString(void)
+{
+    uint32_t size = Read<uint32_t>();
+    std::string value(size, '\0');
+    if (size > 0) {
+        in_.read(&value[0], size);
+        CheckRead();
+    }
+    return value;
+}
+
+
+bool BinaryReader::AtEnd(void)
+{
+    return in_.peek() == std::ifstream::traits_type::eof();
+}
+
+
+void BinaryReader::CheckRead(void)
+{
+    if (in_.fail()) {
+        throw(std::ios_base::failure(std::string("Unexpected end of file ") + path_));
+    }
+}
+
+} // namespace game
@@ -0,0 +1,78 @@
+#ifndef BINARY_IO_H_
+#define BINARY_IO_H_
+
+#include <fstream>
+#include <string>
+#include <cstdint>
+
+namespace game {
+
+    // Writes plain values to a binary file in the machine's byte order
+    // Used by the input logs and world snapshots
+    class BinaryWriter {
+
+        public:
+            // Open a file for writing, throws if it can't be created
+            BinaryWriter(const std::string &path);
+
+            // Write a plain value (int, float, struct of those, ...)
+            template <typename T>
+            inline void Write(const T &value) { out_.write(reinterpret_cast<const char *>(&value), sizeof(T)); }
+
+            // Write a string as a length followed by its characters
+            void WriteString(const std::string &value);
+
+            // Write a std::chrono time point as a count of its clock's ticks
+            template <typename TimePoint>
+            inline void WriteTime(const TimePoint &time) { Write<int64_t>(time.time_since_epoch().count()); }
+
+            // Move to a byte offset, e.g. to patch a header once the data is known
+            inline void Seek(std::streamoff offset) { out_.seekp(offset); }
+
+            // Throws if any write failed (disk full, ...)
+            void Close(void);
+
+        private:
+            std::ofstream out_;
+            std::string path_;
+
+    }; // class BinaryWriter
+
+
+    // Reads back values written by BinaryWriter
+    class BinaryReader {
+
+        public:
+            // Open a file for reading, throws if it can't be opened
+            BinaryReader(const std::string &path);
+
+            // Read a plain value, throws if the file ends early
+            template <typename T>
+            inline T Read(void) {
+                T value;
+                in_.read(reinterpret_cast<char *>(&value), sizeof(T));
+                CheckRead();
+                return value;
+            }
+
+            // Read a string written with WriteString
+            std::string ReadString(void);
+
+            // Read a time point written with WriteTime
+            template <typename TimePoint>
+            inline TimePoint ReadTime(void) { return TimePoint(typename TimePoint::duration(Read<int64_t>())); }
+
+            // True once every byte has been read
+            bool AtEnd(void);
+
+        private:
+            void CheckRead(void);
+
+            std::ifstream in_;
+            std::string path_;
+
+    }; // class BinaryReader
+
+} // namespace game
+
+#endif // BINARY_IO_H_
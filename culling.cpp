@@ -0,0 +1,36 @@
+#include <algorithm>
+
+#include "culling.h"
+
+namespace game {
+
+Rect VisibleRect(const glm::mat4 &view_matrix)
+{
+    glm::mat4 inverse_view = glm::inverse(view_matrix);
+
+    Rect rect;
+    for (int i = 0; i < 4; i++) {
+        glm::vec4 corner = inverse_view * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, 0.0f, 1.0f);
+        glm::vec2 point(corner.x / corner.w, corner.y / corner.w);
+        if (i == 0) {
+            rect.min = point;
+            rect.max = point;
+        }
+        else {
+            rect.min = glm::vec2(std::min(rect.min.x, point.x), std::min(rect.min.y, point.y));
+            rect.max = glm::vec2(std::max(rect.max.x, point.x), std::max(rect.max.y, point.y));
+        }
+    }
+    return rect;
+}
+
+
+bool Overlaps(const Rect &rect, const glm::vec2 &center, float radius)
+{
+    // Distance from the centre to the closest point of the rectangle
+    float dx = center.x - std::min(std::max(center.x, rect.min.x), rect.max.x);
+    float dy = center.y - std::min(std::max(center.y, rect.min.y), rect.max.y);
+    return dx * dx + dy * dy <= radius * radius;
+}
+
+} // namespace game
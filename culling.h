@@ -0,0 +1,24 @@
+#ifndef CULLING_H_
+#define CULLING_H_
+
+#include <glm/glm.hpp>
+
+namespace game {
+
+    // Axis-aligned rectangle in world space
+    struct Rect {
+        glm::vec2 min;
+        glm::vec2 max;
+    };
+
+    // The part of the world a view matrix shows: the screen corners taken
+    // back through the inverse of the view
+    // A spatial broadphase can be queried with it to get candidates to draw
+    Rect VisibleRect(const glm::mat4 &view_matrix);
+
+    // True if a bounding circle touches the rectangle
+    bool Overlaps(const Rect &rect, const glm::vec2 &center, float radius);
+
+} // namespace game
+
+#endif // CULLING_H_
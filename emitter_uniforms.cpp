@@ -0,0 +1,50 @@
+#include <cstddef>
+
+#include "emitter_uniforms.h"
+
+namespace game {
+
+EmitterUniforms::EmitterUniforms(void)
+{
+    ubo_ = 0;
+}
+
+
+EmitterUniforms::~EmitterUniforms()
+{
+    if (ubo_) {
+        glDeleteBuffers(1, &ubo_);
+    }
+}
+
+
+void EmitterUniforms::Init(void)
+{
+    glGenBuffers(1, &ubo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(EmitterData), NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // The binding point never changes, so bind it once
+    glBindBufferBase(GL_UNIFORM_BUFFER, BLOCK_EMITTERS, ubo_);
+}
+
+
+void EmitterUniforms::Update(const EmitterData &data, int count)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+
+    // Orphan the storage, draws still reading the previous group keep it
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(EmitterData), NULL, GL_STREAM_DRAW);
+
+    // Each array only up to the systems in the group
+    GLsizeiptr size = count * sizeof(glm::vec4);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(EmitterData, transform), size, data.transform);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(EmitterData, parent), size, data.parent);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(EmitterData, style), size, data.style);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(EmitterData, tint), size, data.tint);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(EmitterData, procedural), size, data.procedural);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+} // namespace game
@@ -0,0 +1,48 @@
+#ifndef EMITTER_UNIFORMS_H_
+#define EMITTER_UNIFORMS_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+namespace game {
+
+    // Must match MAX_BATCH_EMITTERS in particle_vertex_shader.glsl
+#define MAX_BATCH_EMITTERS 128
+
+    // Values of the particle systems drawn together, one entry per system
+    // The layout is std140 and must match the "Emitters" block in
+    // particle_vertex_shader.glsl; arrays of vec4 have no padding
+    struct EmitterData {
+        glm::vec4 transform[MAX_BATCH_EMITTERS];   // Position (xy), angle (z), scale (w) relative to the parent
+        glm::vec4 parent[MAX_BATCH_EMITTERS];      // Parent's position (xy) and angle (z), particles to draw (w)
+        glm::vec4 style[MAX_BATCH_EMITTERS];       // Cycle (x), speed (y), gravity (z), see ParticleStyle
+        glm::vec4 tint[MAX_BATCH_EMITTERS];        // Colour (rgb)
+        glm::vec4 procedural[MAX_BATCH_EMITTERS];  // Seed (x), range (y), explosion (z), on (w), see GetProcedural
+    };
+
+    // Uniform buffer holding an EmitterData, bound to BLOCK_EMITTERS
+    // It is rewritten for every group of up to MAX_BATCH_EMITTERS systems
+    class EmitterUniforms {
+
+        public:
+            EmitterUniforms(void);
+            ~EmitterUniforms();
+
+            // Create the buffer and bind it (needs an OpenGL context)
+            void Init(void);
+
+            // Write the first count entries of each array, before the draws
+            // that read them
+            void Update(const EmitterData &data, int count);
+
+        private:
+            GLuint ubo_;
+
+    }; // class EmitterUniforms
+
+} // namespace game
+
+#endif // EMITTER_UNIFORMS_H_
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <thread>
+#include <cmath>
+#include <algorithm>
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+
+#include "frame_pacer.h"
+
+namespace game {
+
+// Wake up this long before a capped frame's deadline and spin the rest,
+// which covers the usual oversleep of the OS scheduler
+static const std::chrono::microseconds spin_margin_g(1500);
+
+
+FramePacer::FramePacer(void)
+{
+    mode_ = PACING_VSYNC;
+    frame_length_ = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / 60.0));
+    started_ = false;
+    frames_ = 0;
+    mean_ = 0.0;
+    sum_sq_diff_ = 0.0;
+    min_ = 0.0;
+    max_ = 0.0;
+}
+
+
+void FramePacer::SetMode(PacingMode mode, double frames_per_second)
+{
+    mode_ = mode;
+    if (frames_per_second > 0.0) {
+        frame_length_ = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / frames_per_second));
+    }
+}
+
+
+void FramePacer::Start(void)
+{
+    // The cap is done on the CPU, so only vsync waits for the display
+    glfwSwapInterval(mode_ == PACING_VSYNC ? 1 : 0);
+
+    last_frame_end_ = clock::now();
+    deadline_ = last_frame_end_ + frame_length_;
+    started_ = true;
+}
+
+
+void FramePacer::EndFrame(void)
+{
+    if (!started_) {
+        Start();
+        return;
+    }
+
+    if (mode_ == PACING_CAP) {
+        clock::time_point now = clock::now();
+        if (deadline_ - now > spin_margin_g) {
+            std::this_thread::sleep_for(deadline_ - now - spin_margin_g);
+        }
+        while (clock::now() < deadline_) {
+            std::this_thread::yield();
+        }
+
+        // Schedule from the deadline so the rate does not drift, unless the
+        // frame ran so late that catching up would rush the next ones
+        deadline_ += frame_length_;
+        if (deadline_ < clock::now()) {
+            deadline_ = clock::now() + frame_length_;
+        }
+    }
+
+    clock::time_point end = clock::now();
+    double frame_time = std::chrono::duration<double>(end - last_frame_end_).count();
+    last_frame_end_ = end;
+
+    frames_ += 1;
+    double diff = frame_time - mean_;
+    mean_ += diff / frames_;
+    sum_sq_diff_ += diff * (frame_time - mean_);
+    min_ = (frames_ == 1) ? frame_time : std::min(min_, frame_time);
+    max_ = (frames_ == 1) ? frame_time : std::max(max_, frame_time);
+}
+
+
+void FramePacer::Report(void)
+{
+    if (frames_ == 0) {
+        return;
+    }
+
+    const char *mode_names[] = { "vsync", "capped", "uncapped" };
+    double jitter = (frames_ > 1) ? std::sqrt(sum_sq_diff_ / (frames_ - 1)) : 0.0;
+
+    std::cout << "Frame pacing (" << mode_names[mode_] << "): " << frames_ << " frames, "
+        << mean_ * 1000.0 << " ms average (" << 1.0 / mean_ << " fps), "
+        << jitter * 1000.0 << " ms jitter, "
+        << min_ * 1000.0 << " - " << max_ * 1000.0 << " ms range" << std::endl;
+}
+
+} // namespace game
@@ -0,0 +1,59 @@
+#ifndef FRAME_PACER_H_
+#define FRAME_PACER_H_
+
+#include <chrono>
+
+namespace game {
+
+    // How the main loop waits between frames
+    enum PacingMode {
+        PACING_VSYNC,       // Let glfwSwapBuffers wait for the display
+        PACING_CAP,         // Wait for a fixed frame rate on the CPU
+        PACING_UNCAPPED     // Never wait (benchmarks)
+    };
+
+    // Keeps the main loop at a steady frame rate and measures how steady it was
+    // Capped frames sleep until just before the deadline and then spin, since
+    // sleeps alone can overshoot by a millisecond or more
+    class FramePacer {
+
+        public:
+            FramePacer(void);
+
+            // Pick the mode; the frame rate is only used by PACING_CAP
+            void SetMode(PacingMode mode, double frames_per_second = 60.0);
+
+            // Apply the swap interval for the mode
+            // Needs the window's OpenGL context to be current
+            void Start(void);
+
+            // Call once per frame after glfwSwapBuffers: waits when capped,
+            // then records how long the frame took
+            void EndFrame(void);
+
+            // Print the frame count, average frame time and jitter
+            void Report(void);
+
+        private:
+            typedef std::chrono::steady_clock clock;
+
+            PacingMode mode_;
+            clock::duration frame_length_;
+
+            // When the current frame should end (capped) or started (otherwise)
+            clock::time_point deadline_;
+            clock::time_point last_frame_end_;
+            bool started_;
+
+            // Running statistics of the frame times in seconds (Welford's method)
+            long frames_;
+            double mean_;
+            double sum_sq_diff_;
+            double min_;
+            double max_;
+
+    }; // class FramePacer
+
+} // namespace game
+
+#endif // FRAME_PACER_H_
@@ -0,0 +1,38 @@
+#include "frame_uniforms.h"
+
+namespace game {
+
+FrameUniforms::FrameUniforms(void)
+{
+    ubo_ = 0;
+}
+
+
+FrameUniforms::~FrameUniforms()
+{
+    if (ubo_) {
+        glDeleteBuffers(1, &ubo_);
+    }
+}
+
+
+void FrameUniforms::Init(void)
+{
+    glGenBuffers(1, &ubo_);
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    // The binding point never changes, so bind it once
+    glBindBufferBase(GL_UNIFORM_BUFFER, BLOCK_FRAME, ubo_);
+}
+
+
+void FrameUniforms::Update(const FrameData &data)
+{
+    glBindBuffer(GL_UNIFORM_BUFFER, ubo_);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameData), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+} // namespace game
@@ -0,0 +1,42 @@
+#ifndef FRAME_UNIFORMS_H_
+#define FRAME_UNIFORMS_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
+
+namespace game {
+
+    // Values that are the same for every draw in a frame
+    // The layout is std140 and must match the "Frame" block in the shaders:
+    //   layout(std140) uniform Frame { mat4 view_matrix; vec4 camera; };
+    // Everything is a mat4 or vec4, so there is no padding to get wrong
+    struct FrameData {
+        glm::mat4 view_matrix;
+        glm::vec4 camera;       // Position (xy), zoom (z), time (w)
+    };
+
+    // Uniform buffer holding the FrameData, bound to BLOCK_FRAME so every
+    // shader program reads the same copy
+    class FrameUniforms {
+
+        public:
+            FrameUniforms(void);
+            ~FrameUniforms();
+
+            // Create the buffer and bind it (needs an OpenGL context)
+            void Init(void);
+
+            // Write this frame's values, once per frame before drawing
+            void Update(const FrameData &data);
+
+        private:
+            GLuint ubo_;
+
+    }; // class FrameUniforms
+
+} // namespace game
+
+#endif // FRAME_UNIFORMS_H_
@@ -12,7 +12,9 @@
 #include <chrono>
 #include <thread>
 #include <string>
-#include <random>
+#include <cstring>
+#include <iomanip>
+#include <map>
 #include <path_config.h>
 
 
@@ -21,6 +23,9 @@
 #include "shader.h"
 #include "player_game_object.h"
 #include "particle_system.h"
+#include "rng.h"
+#include "render_state.h"
+#include "culling.h"
 #include "game.h"
 
 namespace game {
@@ -33,22 +38,83 @@ namespace game {
     const unsigned int window_width_g = 1100;
     const unsigned int window_height_g = 800;
     const glm::vec3 viewport_background_color_g(0.0, 0.0, 1.0);
+
+    // The view is zoomed out by this much, centered on the camera
+    const float camera_zoom_g = 0.25f;
+
+    // Particle styles: the orange engine flame, and the green bullet
+    // trails and explosions
+    const ParticleStyle engine_style_g = { 2.0f, 4.0f, 0.0f, glm::vec3(0.8f, 0.4f, 0.01f) };
+    const ParticleStyle effect_style_g = { 3.0f, 4.0f, 0.0f, glm::vec3(0.1f, 1.0f, 0.01f) };
     bool UI_on = false;
     int minigunAmmoCount = 50;   // global variable denoting the amount of ammo you minigun is currently holding
     bool game_is_over = false;
     bool last_frame = false;
     int game_speed = 1;
     std::string survival_time = "N/A";
-    static std::chrono::time_point<std::chrono::system_clock> game_start_time = std::chrono::system_clock::now();
+    static SimClock::time_point game_start_time = SimClock::now();
 
 
     // Directory with game resources such as textures
     const std::string resources_directory_g = RESOURCES_DIRECTORY;
 
+    // File used by the quicksave (F5) and quickload (F9) keys
+    const std::string quicksave_path_g = "quicksave.snap";
+
+    // Snapshots are a header followed by the clock, random streams, loose
+    // game state and then every object (see SaveSnapshot for the layout)
+    const char snapshot_magic_g[4] = { 'F', 'P', 'S', 'N' };
+#define SNAPSHOT_VERSION 1
+
+    // Class of each saved object, so the right one is rebuilt on load
+    enum SnapshotObjectKind { SNAPSHOT_OBJECT, SNAPSHOT_PLAYER, SNAPSHOT_PARTICLE_SYSTEM };
+
+    // Ids of the shared geometry; explosions take turns using a small pool
+    // of geometries (NUM_EXPLOSION_GEOMETRIES), so they are all saved as one
+    // id and handed the next one from the pool on load
+    enum SnapshotGeometry { SNAPSHOT_SPRITE, SNAPSHOT_ENGINE_PARTICLES, SNAPSHOT_TRAIL_PARTICLES, SNAPSHOT_EXPLOSION };
+
+
+    // Seconds of wall time since a given start point, for the per-system timers
+    static double SecondsSince(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
 
     Game::Game(void)
     {
         // Don't do work in the constructor, leave it for the Init() function
+
+        // Only initialize variables with default values
+        window_ = nullptr;
+        headless_ = false;
+        particle_layout_ = PARTICLES_PROCEDURAL;
+        sprite_ = nullptr;
+        particles_ = nullptr;
+        particles2_ = nullptr;
+        for (int i = 0; i < NUM_EXPLOSION_GEOMETRIES; i++) {
+            explosions_[i] = nullptr;
+        }
+        next_explosion_ = 0;
+        current_time_ = 0.0;
+        memset(tex_, 0, sizeof(tex_));
+        memset(system_time_, 0, sizeof(system_time_));
+        frames_rendered_ = 0;
+        objects_drawn_ = 0;
+        objects_culled_ = 0;
+        draw_calls_ = 0;
+        state_changes_ = 0;
+        particles_batched_ = 0;
+
+        first_wave_ = true;
+        first_collectible_ = true;
+        waves_since_speedup_ = 0;
+        first_tab_ = true;
+        first_switch_ = true;
+        first_bullet_ = true;
+        first_aoe_ = true;
+        first_minigun_ = true;
     }
 
 
@@ -89,23 +155,40 @@ namespace game {
         sprite_ = new Sprite();
         sprite_->CreateGeometry();
 
-        // Initialize particle geometry
-        particles_ = new Particles();
-        particles_->CreateGeometry();
-
-        particles2_ = new Particles();
-        particles2_->SetRange(0.02f);
-        particles2_->CreateGeometry();
+        // Initialize particle geometry in the chosen layout
+        Particles *particles = new Particles();
+        particles->SetLayout(particle_layout_);
+        particles->CreateGeometry();
+        particles_ = particles;
+
+        Particles *particles2 = new Particles();
+        particles2->SetRange(0.02f);
+        particles2->SetLayout(particle_layout_);
+        particles2->CreateGeometry();
+        particles2_ = particles2;
+
+        // Explosions share a few geometries instead of building one per kill
+        for (int i = 0; i < NUM_EXPLOSION_GEOMETRIES; i++) {
+            Particles *explosion = new Particles();
+            explosion->SetExplode(true);
+            explosion->SetLayout(particle_layout_);
+            explosion->CreateGeometry();
+            explosions_[i] = explosion;
+        }
 
 
 
         // Initialize particle shader
         particle_shader_.Init((resources_directory_g + std::string("/particle_vertex_shader.glsl")).c_str(), (resources_directory_g + std::string("/particle_fragment_shader.glsl")).c_str());
-        particle_shader2_.Init((resources_directory_g + std::string("/particle_vertex_2.glsl")).c_str(), (resources_directory_g + std::string("/particle_fragment_2.glsl")).c_str());
 
 
         // Initialize sprite shader
         sprite_shader_.Init((resources_directory_g + std::string("/sprite_vertex_shader.glsl")).c_str(), (resources_directory_g + std::string("/sprite_fragment_shader.glsl")).c_str());
+        render_queue_.Init(sprite_);
+        render_queue_.SetParticleBudget(&particle_budget_);
+        frame_uniforms_.Init();
+        particle_engine_.Init(sprite_, resources_directory_g);
+        particle_target_.Init(resources_directory_g);
 
         // Initialize time
         current_time_ = 0.0;
@@ -126,6 +209,35 @@ namespace game {
     }
 
 
+    void Game::InitHeadless(void)
+    {
+        // Same game objects as Init(), but nothing touches OpenGL: geometry
+        // is never uploaded, shaders stay unlinked and textures are not loaded
+        headless_ = true;
+
+        sprite_ = new Sprite();
+
+        particles_ = new Particles();
+
+        particles2_ = new Particles();
+        particles2_->SetRange(0.02f);
+
+        for (int i = 0; i < NUM_EXPLOSION_GEOMETRIES; i++) {
+            Particles *explosion = new Particles();
+            explosion->SetExplode(true);
+            explosions_[i] = explosion;
+        }
+
+        // Textures are never loaded, but each slot still gets a distinct
+        // placeholder name so objects (and snapshots) can tell them apart
+        for (int i = 0; i < NUM_TEXTURES; i++) {
+            tex_[i] = i + 1;
+        }
+
+        current_time_ = 0.0;
+    }
+
+
     Game::~Game()
     {
         // Free memory for all objects
@@ -133,13 +245,21 @@ namespace game {
         delete sprite_;
         delete particles_;
         delete particles2_;
+        for (int i = 0; i < NUM_EXPLOSION_GEOMETRIES; i++) {
+            delete explosions_[i];
+        }
+        for (int i = 0; i < explosion_pool_.size(); i++) {
+            delete explosion_pool_[i];
+        }
         for (int i = 0; i < game_objects_.size(); i++) {
             delete game_objects_[i];
         }
 
         // Close window
-        glfwDestroyWindow(window_);
-        glfwTerminate();
+        if (window_) {
+            glfwDestroyWindow(window_);
+            glfwTerminate();
+        }
     }
 
 
@@ -149,7 +269,15 @@ namespace game {
         // Setup the game world
 
         // Load textures
-        SetAllTextures();
+        if (!headless_) {
+            SetAllTextures();
+        }
+
+        // Warm the explosion pool so kills don't allocate
+        explosion_pool_.reserve(EXPLOSION_POOL_SIZE);
+        while (explosion_pool_.size() < EXPLOSION_POOL_SIZE) {
+            explosion_pool_.push_back(new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), explosions_[0], &particle_shader_, tex_[4], nullptr, effect_style_g));
+        }
 
 
         // Setup the player object (position, texture, vertex count)
@@ -202,8 +330,9 @@ namespace game {
         game_objects_.push_back(background);
 
         // Setup particle system
-        GameObject* particles = new ParticleSystem(glm::vec3(0.0f, -0.5f, 0.0f), particles_, &particle_shader_, tex_[4], game_objects_[0]);
+        ParticleSystem* particles = new ParticleSystem(glm::vec3(0.0f, -0.5f, 0.0f), particles_, &particle_shader_, tex_[4], game_objects_[0], engine_style_g);
         particles->SetScale(0.2);
+        AttachEmitter(particles);
         game_objects_.push_back(particles);
     }
 
@@ -216,51 +345,64 @@ namespace game {
     }
 
 
-    void Game::SetTexture(GLuint w, const char* fname)
+    void Game::SetTexture(GLuint w, const char* fname, GLenum target)
     {
         // Bind texture buffer
-        glBindTexture(GL_TEXTURE_2D, w);
+        glBindTexture(target, w);
 
         // Load texture from a file to the buffer
         int width, height;
         unsigned char* image = SOIL_load_image(fname, &width, &height, 0, SOIL_LOAD_RGBA);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        if (target == GL_TEXTURE_2D_ARRAY) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        }
+        else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
+        }
         SOIL_free_image_data(image);
 
         // Texture Wrapping
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
         // Texture Filtering
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     }
 
 
     void Game::SetAllTextures(void)
     {
         // Load all textures that we will need
+        // Sprites go into the atlas under their tex_ name, which then only
+        // identifies them; the tiled background and the particle texture
+        // are sampled outside [0, 1] or by other shaders, so they stay separate
+        // The sprite shader samples arrays, so the background is a one-layer array
         glGenTextures(NUM_TEXTURES, tex_);
-        SetTexture(tex_[0], (resources_directory_g + std::string("/textures/destroyer_red.png")).c_str());
-        SetTexture(tex_[1], (resources_directory_g + std::string("/textures/destroyer_green.png")).c_str());
-        SetTexture(tex_[2], (resources_directory_g + std::string("/textures/destroyer_blue.png")).c_str());
-        SetTexture(tex_[3], (resources_directory_g + std::string("/textures/stars.png")).c_str());
+        atlas_.Add(tex_[0], resources_directory_g + std::string("/textures/destroyer_red.png"));
+        atlas_.Add(tex_[1], resources_directory_g + std::string("/textures/destroyer_green.png"));
+        atlas_.Add(tex_[2], resources_directory_g + std::string("/textures/destroyer_blue.png"));
+        SetTexture(tex_[3], (resources_directory_g + std::string("/textures/stars.png")).c_str(), GL_TEXTURE_2D_ARRAY);
         SetTexture(tex_[4], (resources_directory_g + std::string("/textures/orb.png")).c_str());
-        SetTexture(tex_[5], (resources_directory_g + std::string("/textures/bullet.png")).c_str());
-        SetTexture(tex_[6], (resources_directory_g + std::string("/textures/blade.png")).c_str());
-        SetTexture(tex_[7], (resources_directory_g + std::string("/textures/aoeSprite.png")).c_str());  //need to change texture
-        SetTexture(tex_[8], (resources_directory_g + std::string("/textures/minigun.png")).c_str());  
+        atlas_.Add(tex_[5], resources_directory_g + std::string("/textures/bullet.png"));
+        atlas_.Add(tex_[6], resources_directory_g + std::string("/textures/blade.png"));
+        atlas_.Add(tex_[7], resources_directory_g + std::string("/textures/aoeSprite.png"));  //need to change texture
+        atlas_.Add(tex_[8], resources_directory_g + std::string("/textures/minigun.png"));
         
         //Textures for collectibles
-        SetTexture(tex_[9], (resources_directory_g + std::string("/textures/Star.png")).c_str()); //Star
-        SetTexture(tex_[10], (resources_directory_g + std::string("/textures/ammo.png")).c_str()); //Ammo 
-        SetTexture(tex_[11], (resources_directory_g + std::string("/textures/heart.png")).c_str()); //Heart
-        SetTexture(tex_[12], (resources_directory_g + std::string("/textures/golden_ship.png")).c_str()); //We will switch to this spaceship when we gold invincible
+        atlas_.Add(tex_[9], resources_directory_g + std::string("/textures/Star.png")); //Star
+        atlas_.Add(tex_[10], resources_directory_g + std::string("/textures/ammo.png")); //Ammo 
+        atlas_.Add(tex_[11], resources_directory_g + std::string("/textures/heart.png")); //Heart
+        atlas_.Add(tex_[12], resources_directory_g + std::string("/textures/golden_ship.png")); //We will switch to this spaceship when we gold invincible
 
         //Textures for new enemies
-        SetTexture(tex_[13], (resources_directory_g + std::string("/textures/red_enemy.png")).c_str()); 
-        SetTexture(tex_[14], (resources_directory_g + std::string("/textures/white_enemy.png")).c_str()); 
-        SetTexture(tex_[15], (resources_directory_g + std::string("/textures/blue_enemy.png")).c_str());
+        atlas_.Add(tex_[13], resources_directory_g + std::string("/textures/red_enemy.png"));
+        atlas_.Add(tex_[14], resources_directory_g + std::string("/textures/white_enemy.png"));
+        atlas_.Add(tex_[15], resources_directory_g + std::string("/textures/blue_enemy.png"));
+
+        atlas_.Build();
+        render_queue_.SetAtlas(&atlas_);
+        std::cout << "Packed sprite textures into " << atlas_.GetPageCount() << " atlas layer(s)" << std::endl;
 
         glBindTexture(GL_TEXTURE_2D, tex_[0]);
     }
@@ -270,14 +412,13 @@ namespace game {
     void Game::MainLoop(void)
     {
         // Loop while the user did not close the window
+        pacer_.Start();
         double last_time = glfwGetTime();
+        bool quicksave_down = false;
+        bool quickload_down = false;
         while (!glfwWindowShouldClose(window_)) {
 
 
-
-
-
-
             // Clear background
             glClearColor(viewport_background_color_g.r,
                 viewport_background_color_g.g,
@@ -285,8 +426,7 @@ namespace game {
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             // Set view to zoom out, centered by default at 0,0
-            float camera_zoom = 0.25f;
-            glm::mat4 view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(camera_zoom, camera_zoom, camera_zoom));
+            glm::mat4 view_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(camera_zoom_g, camera_zoom_g, camera_zoom_g));
 
             // Calculate delta time
             double current_time = glfwGetTime();
@@ -295,51 +435,50 @@ namespace game {
             // Update other events like input handling
             glfwPollEvents();
 
-
-            //Spawn the enemies
-            static std::chrono::time_point<std::chrono::system_clock> last_spawn_time, current_time2;
-            static bool first_wave = true;
-            current_time2 = std::chrono::system_clock::now();
-            static int tick = 0;
-
-            if (first_wave || current_time2 > last_spawn_time + std::chrono::milliseconds(7000 - game_speed * 400)) {
-                //std::cout << "ENEMIES SPAWNED" << std::endl;
-                SpawnEnemies(game_objects_[0]->GetPosition());
-                first_wave = false;
-                last_spawn_time = std::chrono::system_clock::now();
-                tick += 1;
+            // Take this tick's input from the keyboard, or from the log when replaying
+            InputFrame input;
+            input.delta_time = delta_time;
+            input.keys = PollKeyboard(window_);
+            if (playback_.IsOpen()) {
+                uint16_t live_keys = input.keys;
+                if (!playback_.Next(input)) {
+                    std::cout << "Replay finished" << std::endl;
+                    break;
+                }
+                // Still allow quitting in the middle of a replay
+                input.keys |= (live_keys & INPUT_QUIT);
             }
-
-            if (tick == 4) {
-                game_speed += 1;
-                tick = 0;
+            recorder_.Record(input);
+
+            // Quicksave and quickload on key press
+            // They are not part of the input log, and a replay could not
+            // follow a load, so both are ignored while recording or replaying
+            bool logging = recorder_.IsOpen() || playback_.IsOpen();
+            bool quicksave_pressed = !logging && (glfwGetKey(window_, GLFW_KEY_F5) == GLFW_PRESS);
+            bool quickload_pressed = !logging && (glfwGetKey(window_, GLFW_KEY_F9) == GLFW_PRESS);
+            try {
+                if (quicksave_pressed && !quicksave_down) {
+                    SaveSnapshot(quicksave_path_g);
+                }
+                if (quickload_pressed && !quickload_down) {
+                    LoadSnapshot(quicksave_path_g);
+                }
             }
-
-            //Spawn Collectibles
-            static std::chrono::time_point<std::chrono::system_clock> last_collectible_time;
-            static bool first_collectible = true;
-            
-            current_time2 = std::chrono::system_clock::now();
-            
-
-            if (first_collectible || current_time2 > last_collectible_time + std::chrono::milliseconds(4000)) {
-                //std::cout << "ENEMIES SPAWNED" << std::endl;
-                SpawnCollectibles(game_objects_[0]->GetPosition());
-                first_collectible = false;
-                last_collectible_time = std::chrono::system_clock::now();
+            catch (std::exception &e) {
+                std::cerr << e.what() << std::endl;
             }
-
-            
-
-
-
+            quicksave_down = quicksave_pressed;
+            quickload_down = quickload_pressed;
 
             // Update the game
-            Update(view_matrix, delta_time);
+            Update(input.delta_time, input.keys);
+
+            // Draw the game
+            Render(view_matrix);
 
             //Computing the time
             //Get elapsed time in seconds
-            std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
+            SimClock::time_point now = SimClock::now();
             int elapsed_time = static_cast<int>(std::chrono::duration_cast<std::chrono::seconds>(now - game_start_time).count());
 
             //Calculate minutes and seconds
@@ -424,9 +563,499 @@ namespace game {
             // Push buffer drawn in the background onto the display
             glfwSwapBuffers(window_);
 
+            // Wait for the next frame, if capped
+            pacer_.EndFrame();
+
         }
+
+        pacer_.Report();
+        render_queue_.Report();
+        particle_budget_.Report();
+        if (frames_rendered_ > 0) {
+            std::cout << "Rendering (per frame): " << (double)objects_drawn_ / frames_rendered_ << " objects drawn, "
+                << (double)objects_culled_ / frames_rendered_ << " culled, "
+                << (double)draw_calls_ / frames_rendered_ << " draw calls, "
+                << (double)state_changes_ / frames_rendered_ << " state changes, "
+                << (double)particles_batched_ / frames_rendered_ << " particle systems batched" << std::endl;
+        }
+    }
+
+
+    void Game::SetFramePacing(PacingMode mode, double frames_per_second)
+    {
+        pacer_.SetMode(mode, frames_per_second);
+    }
+
+    void Game::SetParticleBackend(ParticleBackend backend)
+    {
+        particle_engine_.SetBackend(backend);
+    }
+
+    void Game::SetParticleLayout(ParticleLayout layout)
+    {
+        particle_layout_ = layout;
+    }
+
+    void Game::SetParticleResolution(int divisor)
+    {
+        particle_target_.SetDivisor(divisor);
+    }
+
+    void Game::Spawn(void)
+    {
+        //Spawn the enemies
+        SimClock::time_point current_time2 = SimClock::now();
+
+        if (first_wave_ || current_time2 > last_spawn_time_ + std::chrono::milliseconds(7000 - game_speed * 400)) {
+            //std::cout << "ENEMIES SPAWNED" << std::endl;
+            SpawnEnemies(game_objects_[0]->GetPosition());
+            first_wave_ = false;
+            last_spawn_time_ = SimClock::now();
+            waves_since_speedup_ += 1;
+        }
+
+        if (waves_since_speedup_ == 4) {
+            game_speed += 1;
+            waves_since_speedup_ = 0;
+        }
+
+        //Spawn Collectibles
+        current_time2 = SimClock::now();
+
+        if (first_collectible_ || current_time2 > last_collectible_time_ + std::chrono::milliseconds(4000)) {
+            //std::cout << "ENEMIES SPAWNED" << std::endl;
+            SpawnCollectibles(game_objects_[0]->GetPosition());
+            first_collectible_ = false;
+            last_collectible_time_ = SimClock::now();
+        }
+    }
+
+
+    void Game::RunHeadless(int ticks, double delta_time)
+    {
+        if (playback_.IsOpen()) {
+            ticks = playback_.GetTickCount();
+            std::cout << "Replaying " << ticks << " recorded ticks (seed " << GetRunSeed() << ")" << std::endl;
+        }
+        else {
+            std::cout << "Running " << ticks << " headless ticks of " << delta_time * 1000.0 << " ms (seed " << GetRunSeed() << ")" << std::endl;
+        }
+
+        size_t peak_objects = 0;
+        double game_time = 0.0;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ticks; i++) {
+            InputFrame input;
+            input.delta_time = delta_time;
+            input.keys = 0;
+            if (playback_.IsOpen() && !playback_.Next(input)) {
+                ticks = i;
+                break;
+            }
+            recorder_.Record(input);
+
+            Update(input.delta_time, input.keys);
+            game_time += input.delta_time;
+            peak_objects = std::max(peak_objects, game_objects_.size());
+        }
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        double wall_time = std::chrono::duration<double>(end - start).count();
+
+        // Count the entities left in the world by type
+        std::map<std::string, int> counts;
+        for (int i = 0; i < game_objects_.size(); i++) {
+            counts[game_objects_[i]->GetType()] += 1;
+        }
+
+        // Hash the final object state, so two runs (or two builds) can be
+        // checked for identical results at a glance
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < game_objects_.size(); i++) {
+            const glm::vec3& pos = game_objects_[i]->GetPosition();
+            float values[3] = { pos.x, pos.y, game_objects_[i]->GetAngle() };
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+            for (int b = 0; b < sizeof(values); b++) {
+                hash = (hash ^ bytes[b]) * 1099511628211ULL;
+            }
+        }
+
+        const char* system_names[NUM_SIM_SYSTEMS] = { "spawn", "input", "update", "collision", "render" };
+        double system_total = 0.0;
+        for (int i = 0; i < NUM_SIM_SYSTEMS; i++) {
+            system_total += system_time_[i];
+        }
+
+        std::cout << std::fixed << std::setprecision(3);
+        std::cout << "Wall time:      " << wall_time << " s for " << game_time << " s of game time" << std::endl;
+        std::cout << "Ticks/sec:      " << ticks / wall_time << " (" << game_time / wall_time << "x real time)" << std::endl;
+        std::cout << "Per system (total ms, us/tick, share):" << std::endl;
+        for (int i = 0; i < NUM_SIM_SYSTEMS; i++) {
+            if (system_time_[i] == 0.0) {
+                continue;
+            }
+            std::cout << "  " << std::left << std::setw(12) << system_names[i] << std::right
+                << std::setw(10) << system_time_[i] * 1000.0
+                << std::setw(10) << system_time_[i] * 1e6 / ticks
+                << std::setw(8) << 100.0 * system_time_[i] / system_total << "%" << std::endl;
+        }
+        std::cout << "Entities:       " << game_objects_.size() << " alive, " << peak_objects << " peak" << std::endl;
+        for (std::map<std::string, int>::iterator it = counts.begin(); it != counts.end(); ++it) {
+            std::cout << "  " << std::left << std::setw(12) << it->first << std::right << std::setw(6) << it->second << std::endl;
+        }
+        std::cout << "Player:         " << game_objects_[0]->GetKillCount() << " kills, " << game_objects_[0]->GetHealth() << " health" << std::endl;
+        std::cout << "World hash:     " << std::hex << hash << std::dec << std::endl;
+    }
+
+
+    void Game::StartRecording(const std::string &path)
+    {
+        recorder_.Open(path, GetRunSeed());
+        std::cout << "Recording input to " << path << std::endl;
+    }
+
+
+    void Game::StartReplay(const std::string &path)
+    {
+        playback_.Open(path);
+        SetRunSeed(playback_.GetSeed());
+        std::cout << "Replaying input from " << path << " (" << playback_.GetTickCount() << " ticks)" << std::endl;
+    }
+
+
+    void Game::SaveSnapshot(const std::string &path)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        BinaryWriter out(path);
+
+        out.Write(snapshot_magic_g);
+        out.Write<uint16_t>(SNAPSHOT_VERSION);
+        out.Write<uint16_t>(0);
+
+        // Clock and random streams
+        out.WriteTime(SimClock::now());
+        out.Write<double>(current_time_);
+        out.Write<uint64_t>(GetRunSeed());
+        out.Write<uint32_t>(NUM_RANDOM_STREAMS);
+        for (int i = 0; i < NUM_RANDOM_STREAMS; i++) {
+            out.Write<uint64_t>(GetRng((RandomStream)i).GetState());
+            out.Write<uint64_t>(GetRng((RandomStream)i).GetIncrement());
+        }
+
+        // Loose game state and timers
+        out.Write<int>(minigunAmmoCount);
+        out.Write<int>(game_speed);
+        out.Write<bool>(game_is_over);
+        out.Write<bool>(last_frame);
+        out.WriteTime(last_spawn_time_);
+        out.WriteTime(last_collectible_time_);
+        out.Write<bool>(first_wave_);
+        out.Write<bool>(first_collectible_);
+        out.Write<int>(waves_since_speedup_);
+        out.WriteTime(last_tab_time_);
+        out.WriteTime(last_switch_time_);
+        out.WriteTime(last_bullet_time_);
+        out.WriteTime(last_aoe_time_);
+        out.WriteTime(last_minigun_time_);
+        out.Write<bool>(first_tab_);
+        out.Write<bool>(first_switch_);
+        out.Write<bool>(first_bullet_);
+        out.Write<bool>(first_aoe_);
+        out.Write<bool>(first_minigun_);
+
+        // Objects refer to each other by their index in the list
+        std::map<GameObject*, int> indices;
+        for (int i = 0; i < game_objects_.size(); i++) {
+            indices[game_objects_[i]] = i;
+        }
+
+        out.Write<uint32_t>((uint32_t)game_objects_.size());
+        for (int i = 0; i < game_objects_.size(); i++) {
+            GameObject* object = game_objects_[i];
+
+            int kind = SNAPSHOT_OBJECT;
+            if (dynamic_cast<PlayerGameObject*>(object)) {
+                kind = SNAPSHOT_PLAYER;
+            }
+            else if (dynamic_cast<ParticleSystem*>(object)) {
+                kind = SNAPSHOT_PARTICLE_SYSTEM;
+            }
+
+            // An object whose parent was already removed is saved with -1
+            std::map<GameObject*, int>::iterator parent = indices.find(object->GetParent());
+            int parent_index = (parent == indices.end()) ? -1 : parent->second;
+
+            out.Write<int32_t>(kind);
+            out.Write<int32_t>(GeometryId(object->GetGeometry()));
+            out.Write<int32_t>(ShaderId(object->GetShader()));
+            out.Write<int32_t>(TextureId(object->GetTexture()));
+            out.Write<int32_t>(TextureId(object->GetGoldTexture()));
+            out.Write<int32_t>(parent_index);
+            out.Write<bool>(object->CanFire());
+            out.Write<int32_t>(GeometryId(object->GetBulletGeometry()));
+            out.Write<int32_t>(ShaderId(object->GetBulletShader()));
+            out.Write<int32_t>(TextureId(object->GetBulletTexture()));
+            object->Save(out);
+        }
+
+        out.Close();
+
+        std::cout << "Saved snapshot " << path << " (" << game_objects_.size() << " objects) in "
+            << SecondsSince(start) * 1000.0 << " ms" << std::endl;
     }
 
+
+    void Game::LoadSnapshot(const std::string &path)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        BinaryReader in(path);
+
+        char magic[4];
+        for (int i = 0; i < 4; i++) {
+            magic[i] = in.Read<char>();
+        }
+        if (memcmp(magic, snapshot_magic_g, 4) != 0) {
+            throw(std::ios_base::failure(path + std::string(" is not a snapshot")));
+        }
+        uint16_t version = in.Read<uint16_t>();
+        if (version != SNAPSHOT_VERSION) {
+            throw(std::ios_base::failure(path + std::string(" has unsupported snapshot version ") + std::to_string(version)));
+        }
+        in.Read<uint16_t>();
+
+        // Everything is read into locals first, so a truncated or corrupt
+        // file throws before any of the current world is replaced
+        // Clock and random streams
+        SimClock::time_point clock_time = in.ReadTime<SimClock::time_point>();
+        double current_time = in.Read<double>();
+        uint64_t run_seed = in.Read<uint64_t>();
+        if (in.Read<uint32_t>() != NUM_RANDOM_STREAMS) {
+            throw(std::ios_base::failure(path + std::string(" was saved with a different set of random streams")));
+        }
+        uint64_t rng_states[NUM_RANDOM_STREAMS], rng_increments[NUM_RANDOM_STREAMS];
+        for (int i = 0; i < NUM_RANDOM_STREAMS; i++) {
+            rng_states[i] = in.Read<uint64_t>();
+            rng_increments[i] = in.Read<uint64_t>();
+        }
+
+        // Loose game state and timers
+        int minigun_ammo = in.Read<int>();
+        int speed = in.Read<int>();
+        bool is_over = in.Read<bool>();
+        bool is_last_frame = in.Read<bool>();
+        SimClock::time_point last_spawn_time = in.ReadTime<SimClock::time_point>();
+        SimClock::time_point last_collectible_time = in.ReadTime<SimClock::time_point>();
+        bool first_wave = in.Read<bool>();
+        bool first_collectible = in.Read<bool>();
+        int waves_since_speedup = in.Read<int>();
+        SimClock::time_point last_tab_time = in.ReadTime<SimClock::time_point>();
+        SimClock::time_point last_switch_time = in.ReadTime<SimClock::time_point>();
+        SimClock::time_point last_bullet_time = in.ReadTime<SimClock::time_point>();
+        SimClock::time_point last_aoe_time = in.ReadTime<SimClock::time_point>();
+        SimClock::time_point last_minigun_time = in.ReadTime<SimClock::time_point>();
+        bool first_tab = in.Read<bool>();
+        bool first_switch = in.Read<bool>();
+        bool first_bullet = in.Read<bool>();
+        bool first_aoe = in.Read<bool>();
+        bool first_minigun = in.Read<bool>();
+
+        // Objects; they fire into game_objects_, which gets their list below
+        std::vector<GameObject*> loaded;
+        int next_explosion = next_explosion_;
+        try {
+            uint32_t count = in.Read<uint32_t>();
+            std::vector<int> parents;
+            for (uint32_t i = 0; i < count; i++) {
+                int kind = in.Read<int32_t>();
+                Geometry* geom = GeometryFromId(in.Read<int32_t>());
+                Shader* shader = ShaderFromId(in.Read<int32_t>());
+                GLuint texture = TextureFromId(in.Read<int32_t>());
+                GLuint gold_texture = TextureFromId(in.Read<int32_t>());
+                parents.push_back(in.Read<int32_t>());
+                bool can_fire = in.Read<bool>();
+                int bullet_geom = in.Read<int32_t>();
+                Shader* bullet_shader = ShaderFromId(in.Read<int32_t>());
+                GLuint bullet_texture = TextureFromId(in.Read<int32_t>());
+
+                GameObject* object;
+                if (kind == SNAPSHOT_PLAYER) {
+                    object = new PlayerGameObject(glm::vec3(0.0f, 0.0f, 0.0f), geom, shader, texture);
+                }
+                else if (kind == SNAPSHOT_PARTICLE_SYSTEM) {
+                    object = new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), geom, shader, texture, nullptr, StyleFor(geom));
+                }
+                else if (kind == SNAPSHOT_OBJECT) {
+                    object = new GameObject(glm::vec3(0.0f, 0.0f, 0.0f), geom, shader, texture);
+                }
+                else {
+                    throw(std::ios_base::failure(path + std::string(" has an object of unknown kind ") + std::to_string(kind)));
+                }
+                loaded.push_back(object);
+                object->SetGoldShip(gold_texture);
+                if (can_fire) {
+                    object->InitFiring(GeometryFromId(bullet_geom), bullet_shader, bullet_texture, game_objects_, 1);
+                }
+
+                // Restores everything else, including the weapon type set above
+                object->Load(in);
+            }
+            if (!in.AtEnd()) {
+                throw(std::ios_base::failure(path + std::string(" has data past the last object")));
+            }
+
+            // The game follows the player, which is always the first object
+            if (loaded.empty() || !dynamic_cast<PlayerGameObject*>(loaded[0])) {
+                throw(std::ios_base::failure(path + std::string(" has no player")));
+            }
+
+            // Relink parents, then drop objects that only lived as long as a
+            // parent that was already gone when the snapshot was taken
+            for (uint32_t i = 0; i < count; i++) {
+                if (parents[i] >= 0 && parents[i] < count) {
+                    loaded[i]->RestoreParent(loaded[parents[i]]);
+                }
+            }
+            for (int i = loaded.size() - 1; i >= 0; i--) {
+                GameObject* object = loaded[i];
+                bool needs_parent = object->CheckIfChild() || dynamic_cast<ParticleSystem*>(object);
+                if (needs_parent && object->GetParent() == nullptr) {
+                    delete object;
+                    loaded.erase(loaded.begin() + i);
+                }
+            }
+        }
+        catch (...) {
+            for (int i = 0; i < loaded.size(); i++) {
+                delete loaded[i];
+            }
+            next_explosion_ = next_explosion;
+            throw;
+        }
+
+        // The whole file is valid, replace the current world
+        SimClock::Reset(clock_time);
+        current_time_ = current_time;
+        SetRunSeed(run_seed);
+        for (int i = 0; i < NUM_RANDOM_STREAMS; i++) {
+            GetRng((RandomStream)i).SetState(rng_states[i], rng_increments[i]);
+        }
+
+        minigunAmmoCount = minigun_ammo;
+        game_speed = speed;
+        game_is_over = is_over;
+        last_frame = is_last_frame;
+        last_spawn_time_ = last_spawn_time;
+        last_collectible_time_ = last_collectible_time;
+        first_wave_ = first_wave;
+        first_collectible_ = first_collectible;
+        waves_since_speedup_ = waves_since_speedup;
+        last_tab_time_ = last_tab_time;
+        last_switch_time_ = last_switch_time;
+        last_bullet_time_ = last_bullet_time;
+        last_aoe_time_ = last_aoe_time;
+        last_minigun_time_ = last_minigun_time;
+        first_tab_ = first_tab;
+        first_switch_ = first_switch;
+        first_bullet_ = first_bullet;
+        first_aoe_ = first_aoe;
+        first_minigun_ = first_minigun;
+
+        for (int i = 0; i < game_objects_.size(); i++) {
+            delete game_objects_[i];
+        }
+        game_objects_.swap(loaded);
+
+        // Emitters are not saved; systems that had one get a new one
+        for (int i = 0; i < game_objects_.size(); i++) {
+            ParticleSystem* system = dynamic_cast<ParticleSystem*>(game_objects_[i]);
+            if (system && !system->CheckDead()) {
+                AttachEmitter(system);
+            }
+        }
+
+        std::cout << "Loaded snapshot " << path << " (" << game_objects_.size() << " objects) in "
+            << SecondsSince(start) * 1000.0 << " ms" << std::endl;
+    }
+
+
+    ParticleStyle Game::StyleFor(Geometry *geom)
+    {
+        if (geom == particles_) {
+            return engine_style_g;
+        }
+        return effect_style_g;
+    }
+
+
+    int Game::GeometryId(Geometry *geom)
+    {
+        if (geom == sprite_) {
+            return SNAPSHOT_SPRITE;
+        }
+        if (geom == particles_) {
+            return SNAPSHOT_ENGINE_PARTICLES;
+        }
+        if (geom == particles2_) {
+            return SNAPSHOT_TRAIL_PARTICLES;
+        }
+        return SNAPSHOT_EXPLOSION;
+    }
+
+
+    Geometry *Game::GeometryFromId(int id)
+    {
+        switch (id) {
+            case SNAPSHOT_SPRITE:
+                return sprite_;
+            case SNAPSHOT_ENGINE_PARTICLES:
+                return particles_;
+            case SNAPSHOT_TRAIL_PARTICLES:
+                return particles2_;
+            default:
+                // Any of the shared explosion geometries will do
+                return NextExplosionGeometry();
+        }
+    }
+
+
+    int Game::ShaderId(Shader *shader)
+    {
+        if (shader == &particle_shader_) {
+            return 1;
+        }
+        return 0;
+    }
+
+
+    Shader *Game::ShaderFromId(int id)
+    {
+        // Snapshots from before the particle shaders were merged use 2 as well
+        if (id == 1 || id == 2) {
+            return &particle_shader_;
+        }
+        return &sprite_shader_;
+    }
+
+
+    int Game::TextureId(GLuint texture)
+    {
+        for (int i = 0; i < NUM_TEXTURES; i++) {
+            if (tex_[i] == texture) {
+                return i;
+            }
+        }
+        return 0;
+    }
+
+
+    GLuint Game::TextureFromId(int id)
+    {
+        if (id < 0 || id >= NUM_TEXTURES) {
+            return tex_[0];
+        }
+        return tex_[id];
+    }
+
+
     bool Game::RayCollision(glm::vec3 start, glm::vec3 direction, glm::vec3 center, float radius) {
         //Quick explanation
         //First I need the direction from the ray start to the center of the circle
@@ -457,21 +1086,18 @@ namespace game {
 
 
     void Game::SpawnEnemies(glm::vec3 playerPos) {
-        std::random_device rand_device;
-        std::mt19937 spawn(rand_device());
-        std::uniform_real_distribution<> dis(-3.5, 3.5);
+        Rng& spawn = GetRng(RNG_ENEMY_SPAWN);
 
         
 
         
         for (int i = 0; i < 4 + game_speed; i++) {
 
-            std::uniform_real_distribution<> col(1, 11);
-            int type = static_cast<int>(col(spawn));
+            int type = spawn.UniformInt(1, 11);
             
             if (type >= 1 && type < 7) {
                 //60% chance to spawn normal bullet enemy
-                GameObject* enemy1 = new GameObject(glm::vec3(dis(spawn), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[13]);
+                GameObject* enemy1 = new GameObject(glm::vec3(spawn.Uniform(-3.5f, 3.5f), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[13]);
                 enemy1->SetType("enemy");
                 enemy1->InitFiring(sprite_, &sprite_shader_, tex_[5], game_objects_, 1);
                 game_objects_.insert(game_objects_.begin() + 1, enemy1);
@@ -479,7 +1105,7 @@ namespace game {
 
             if (type >= 7 && type < 10) {
                 //30% chance to spawn aoe bullet enemy
-                GameObject* enemy1 = new GameObject(glm::vec3(dis(spawn), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[14]);
+                GameObject* enemy1 = new GameObject(glm::vec3(spawn.Uniform(-3.5f, 3.5f), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[14]);
                 enemy1->SetType("enemy");
                 enemy1->InitFiring(sprite_, &sprite_shader_, tex_[7], game_objects_, 2);
                 game_objects_.insert(game_objects_.begin() + 1, enemy1);
@@ -487,7 +1113,7 @@ namespace game {
 
             if (type >= 10) {
                 //10% chance to spawn minigun enemy
-                GameObject* enemy1 = new GameObject(glm::vec3(dis(spawn), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[15]);
+                GameObject* enemy1 = new GameObject(glm::vec3(spawn.Uniform(-3.5f, 3.5f), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[15]);
                 enemy1->SetType("enemy");
                 enemy1->InitFiring(sprite_, &sprite_shader_, tex_[8], game_objects_, 3);
                 game_objects_.insert(game_objects_.begin() + 1, enemy1);
@@ -510,15 +1136,12 @@ namespace game {
         //3 is +1 health (heart)
 
 
-        std::random_device rand_device;
-        std::mt19937 spawn(rand_device());
-        std::uniform_real_distribution<> dis(-3.5, 3.5);
-        std::uniform_real_distribution<> col(1, 4);
+        Rng& spawn = GetRng(RNG_COLLECTIBLE_SPAWN);
 
-        int type = static_cast<int>(col(spawn));
+        int type = spawn.UniformInt(1, 4);
 
         if (type == 1) {
-            GameObject* collectible = new GameObject(glm::vec3(dis(spawn), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[9]);
+            GameObject* collectible = new GameObject(glm::vec3(spawn.Uniform(-3.5f, 3.5f), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[9]);
             collectible->SetType("star");
             collectible->SetScale(0.5);
             //collectible->InitFiring(sprite_, &sprite_shader_, tex_[5], game_objects_, 1);
@@ -526,7 +1149,7 @@ namespace game {
         }
 
         if (type == 2) {
-            GameObject* collectible = new GameObject(glm::vec3(dis(spawn), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[10]);
+            GameObject* collectible = new GameObject(glm::vec3(spawn.Uniform(-3.5f, 3.5f), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[10]);
             collectible->SetType("ammo");
             collectible->SetScale(0.5);
             //collectible->InitFiring(sprite_, &sprite_shader_, tex_[5], game_objects_, 1);
@@ -534,7 +1157,7 @@ namespace game {
         }
 
         if (type == 3) {
-            GameObject* collectible = new GameObject(glm::vec3(dis(spawn), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[11]);
+            GameObject* collectible = new GameObject(glm::vec3(spawn.Uniform(-3.5f, 3.5f), playerPos.y + 7.0f, 0.0f), sprite_, &sprite_shader_, tex_[11]);
             collectible->SetType("heart");
             collectible->SetScale(0.5);
             //collectible->InitFiring(sprite_, &sprite_shader_, tex_[5], game_objects_, 1);
@@ -546,31 +1169,126 @@ namespace game {
     }
 
 
-    void Game::Update(glm::mat4 view_matrix, double delta_time)
+    Geometry *Game::NextExplosionGeometry(void)
     {
+        Geometry *geom = explosions_[next_explosion_];
+        next_explosion_ = (next_explosion_ + 1) % NUM_EXPLOSION_GEOMETRIES;
+        return geom;
+    }
 
-        // Update time
-        current_time_ += delta_time;
 
-        // Handle user input
-        Controls(delta_time);
+    bool Game::IsExplosion(GameObject *object)
+    {
+        for (int i = 0; i < NUM_EXPLOSION_GEOMETRIES; i++) {
+            if (object->GetGeometry() == explosions_[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
 
-        //View matrix is updated to follow the player
-        glm::vec3 playerPos = dynamic_cast<PlayerGameObject*>(game_objects_[0])->GetPosition();
-        glm::vec3 offset = glm::vec3(0.0f, 2.0f, 0.0f);
 
-        //view_matrix = glm::translate(view_matrix, -playerPos - offset);
+    ParticleSystem *Game::SpawnExplosion(GameObject *parent)
+    {
+        // Reuse a finished explosion if there is one
+        ParticleSystem *explosion;
+        if (explosion_pool_.empty()) {
+            explosion = new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), NextExplosionGeometry(), &particle_shader_, tex_[4], parent, effect_style_g);
+        }
+        else {
+            explosion = explosion_pool_.back();
+            explosion_pool_.pop_back();
+            explosion->Restart(glm::vec3(0.0f, 0.0f, 0.0f), NextExplosionGeometry(), parent);
+        }
+        explosion->SetScale(0.2);
+        AttachEmitter(explosion);
+        return explosion;
+    }
 
-        glm::vec3 cameraPos = glm::vec3(0.0f, playerPos.y, 0.0f);
-        view_matrix = glm::translate(view_matrix, -cameraPos - offset);
+
+    bool Game::AttachEmitter(ParticleSystem *system)
+    {
+        // Each uses the tint of its particle style
+        EmitterParams params;
+        params.gravity = 0.0f;
+        params.color = effect_style_g.tint;
+        int burst = 0;
+
+        if (system->GetGeometry() == particles_) {
+            // Engine flame: a dense narrow stream that trails the ship, about
+            // as long as the old flame (cycle * speed * scale)
+            params.rate = 300.0f;
+            params.speed = 0.7f;
+            params.spread = 0.13f;
+            params.lifetime = 1.8f;
+            params.drag = 0.5f;
+            params.size = 0.1f;
+            params.follow = 0.8f;
+            params.color = engine_style_g.tint;
+        }
+        else if (system->GetGeometry() == particles2_) {
+            // Bullet trail: a steady narrow stream out of the back
+            params.rate = 240.0f;
+            params.speed = 1.2f;
+            params.spread = 0.1f;
+            params.lifetime = 0.6f;
+            params.drag = 1.0f;
+            params.size = 0.08f;
+            params.follow = 0.0f;
+        }
+        else if (IsExplosion(system)) {
+            // Explosion: one burst in every direction, slowing down
+            params.rate = 0.0f;
+            params.speed = 2.5f;
+            params.spread = glm::pi<float>();
+            params.lifetime = 0.9f;
+            params.drag = 2.0f;
+            params.size = 0.1f;
+            params.follow = 0.6f; // Drift along with the wreck
+            burst = 500;
+        }
+        else {
+            return false;
+        }
+
+        int emitter = particle_engine_.CreateEmitter(params);
+        if (emitter < 0) {
+            return false;
+        }
+        if (burst > 0) {
+            // Bursts take their share of the budget when they go off
+            glm::vec2 center;
+            float radius;
+            system->GetBounds(center, radius);
+            burst = (int)(burst * particle_budget_.Allocate(center, radius, burst));
+            particle_engine_.Burst(emitter, burst);
+        }
+        system->AttachEmitter(&particle_engine_, emitter);
+        return true;
+    }
 
 
+    void Game::Update(double delta_time, uint16_t keys)
+    {
 
+        // Update time
+        current_time_ += delta_time;
+        SimClock::Advance(delta_time);
 
+        // Spawn new enemies and collectibles
+        std::chrono::steady_clock::time_point system_start = std::chrono::steady_clock::now();
+        Spawn();
+        system_time_[SYS_SPAWN] += SecondsSince(system_start);
 
+        // Handle user input
+        system_start = std::chrono::steady_clock::now();
+        Controls(delta_time, keys);
+        system_time_[SYS_INPUT] += SecondsSince(system_start);
 
+        glm::vec3 playerPos = dynamic_cast<PlayerGameObject*>(game_objects_[0])->GetPosition();
 
-        // Update and render all game objects
+
+        // Update all game objects
         for (int i = 0; i < game_objects_.size(); i++) {
 
             //These bools will ensure we only deal with bullets, aoe and enemies
@@ -587,24 +1305,32 @@ namespace game {
             }
 
             // Update the current game object
+            system_start = std::chrono::steady_clock::now();
             current_game_object->Update(delta_time);
 
             if (current_game_object->CheckIfChild()) {
                 current_game_object->SetPosition(glm::vec3(0.0f, 0.0f, 0.0f));
             }
+            system_time_[SYS_UPDATE] += SecondsSince(system_start);
 
             if (current_game_object->CheckDead()) {
                 game_objects_.erase(game_objects_.begin() + i);
 
+                // Nothing points at a finished explosion, so it can be reused
+                if (IsExplosion(current_game_object)) {
+                    explosion_pool_.push_back((ParticleSystem *)current_game_object);
+                }
+
                 continue;
             }
 
             if (current_game_object->CheckGhost()) {
                 //if we're ghosted, stop collision
-                current_game_object->Render(view_matrix, current_time_);
                 continue;
             }
 
+            system_start = std::chrono::steady_clock::now();
+
 
             //First we need the velocity of the bullet      /other projectile
             glm::vec3 direction = current_game_object->GetVelocity();
@@ -767,12 +1493,7 @@ namespace game {
                             //I plan on creating an explosion particle effect and stuff
 
                             // Setup particle system
-                            particles3_ = new Particles();
-                            particles3_->SetExplode(true);
-                            particles3_->CreateGeometry();
-                            GameObject* particles = new ParticleSystem(glm::vec3(0.0f, 0.0f, 0.0f), particles3_, &particle_shader2_, tex_[4], other_game_object);
-                            particles->SetScale(0.2);
-                            game_objects_.push_back(particles);
+                            game_objects_.push_back(SpawnExplosion(other_game_object));
 
 
                             //This causes a bug where you can still hit a dead enemy since they don't actually despawn for 2s
@@ -799,17 +1520,75 @@ namespace game {
 
             }
 
-            // Render game object
-            current_game_object->Render(view_matrix, current_time_);
+            system_time_[SYS_COLLISION] += SecondsSince(system_start);
         }
 
+        // Spawn, age and move the simulated particles
+        system_start = std::chrono::steady_clock::now();
+        particle_engine_.Update((float)delta_time);
+        system_time_[SYS_UPDATE] += SecondsSince(system_start);
+    }
+
 
+    void Game::Render(glm::mat4 view_matrix)
+    {
+        std::chrono::steady_clock::time_point system_start = std::chrono::steady_clock::now();
 
+        //View matrix is updated to follow the player
+        glm::vec3 playerPos = game_objects_[0]->GetPosition();
+        glm::vec3 offset = glm::vec3(0.0f, 2.0f, 0.0f);
 
+        //view_matrix = glm::translate(view_matrix, -playerPos - offset);
+
+        glm::vec3 cameraPos = glm::vec3(0.0f, playerPos.y, 0.0f);
+        view_matrix = glm::translate(view_matrix, -cameraPos - offset);
+
+        // Every shader reads the view and time from the shared block
+        FrameData frame;
+        frame.view_matrix = view_matrix;
+        frame.camera = glm::vec4(cameraPos.x + offset.x, cameraPos.y + offset.y, camera_zoom_g, (float)current_time_);
+        frame_uniforms_.Update(frame);
+
+        // Render all game objects
+        // ImGui sets its own state at the end of the last frame
+        ResetRenderPass();
+        // Objects whose bounds are outside the view are not queued at all
+        Rect visible = VisibleRect(view_matrix);
+        particle_budget_.Begin(visible);
+        render_queue_.Begin();
+        for (int i = 0; i < game_objects_.size(); i++) {
+            glm::vec2 center;
+            float radius;
+            game_objects_[i]->GetBounds(center, radius);
+            if (!Overlaps(visible, center, radius)) {
+                objects_culled_++;
+                continue;
+            }
+            game_objects_[i]->Render(render_queue_, current_time_);
+            objects_drawn_++;
+        }
+        render_queue_.Sort();
+        render_queue_.SubmitPass(PASS_SPRITES);
+
+        // Particles may go to a smaller framebuffer, added over the sprites after
+        int width, height;
+        glfwGetFramebufferSize(window_, &width, &height);
+        particle_target_.Begin(width, height);
+        render_queue_.SubmitPass(PASS_PARTICLES);
+        particle_engine_.Draw(tex_[4]);
+        particle_target_.End();
+        particle_budget_.End();
+
+        frames_rendered_++;
+        draw_calls_ += render_queue_.GetDrawCount();
+        state_changes_ += render_queue_.GetStateChangeCount();
+        particles_batched_ += render_queue_.GetBatchedParticleCount();
+
+        system_time_[SYS_RENDER] += SecondsSince(system_start);
     }
 
 
-    void Game::Controls(double delta_time)
+    void Game::Controls(double delta_time, uint16_t keys)
     {
         // Get player game object
         GameObject* player = game_objects_[0];
@@ -824,31 +1603,25 @@ namespace game {
         float motion_increment = 0.001 * speed;
         float angle_increment = (glm::pi<float>() / 1800.0f) * speed;
         //aaint minigunAmmoCount = 0;
-        static std::chrono::time_point<std::chrono::system_clock> current_time, last_bullet_time, last_tab_time, last_aoe_time, last_switch_time, last_minigun_time;    //edited to also have aoe and weapon switch
-        static bool first_bullet = true;
-        static bool first_aoe = true;
-        static bool first_minigun = true;
-        static bool first_switch = true;
-
-        static bool first_tab = true;
+        SimClock::time_point current_time;
         player->SetPosition(curpos + motion_increment * game_speed * dir);
 
         // Check for player input and make changes accordingly
-        if (glfwGetKey(window_, GLFW_KEY_W) == GLFW_PRESS) {
+        if (keys & INPUT_W) {
             //player->SetPosition(curpos + motion_increment*dir);
         }
-        if (glfwGetKey(window_, GLFW_KEY_S) == GLFW_PRESS) {
+        if (keys & INPUT_S) {
             //player->SetPosition(curpos - motion_increment * dir);
         }
-        if (glfwGetKey(window_, GLFW_KEY_TAB) == GLFW_PRESS) {
+        if (keys & INPUT_MENU) {
             //Make it so you can only tab once every 1s (ish)
-            current_time = std::chrono::system_clock::now();
+            current_time = SimClock::now();
 
-            if (first_tab || current_time > last_tab_time + std::chrono::milliseconds(300)) {
+            if (first_tab_ || current_time > last_tab_time_ + std::chrono::milliseconds(300)) {
                 UI_on = !UI_on;
 
-                last_tab_time = std::chrono::system_clock::now();
-                first_tab = false;
+                last_tab_time_ = SimClock::now();
+                first_tab_ = false;
             }
 
             if (game_is_over) {
@@ -856,7 +1629,7 @@ namespace game {
             }
 
         }
-        if (glfwGetKey(window_, GLFW_KEY_D) == GLFW_PRESS) {
+        if (keys & INPUT_RIGHT) {
 
 
             //player->SetPosition(curpos + motion_increment * 2 * player->GetRight());
@@ -864,48 +1637,48 @@ namespace game {
             //std::cout << "(" << player->GetVelocity().x  << "," << player->GetVelocity().y << ")" << std::endl;
 
         }
-        if (glfwGetKey(window_, GLFW_KEY_A) == GLFW_PRESS) {
+        if (keys & INPUT_LEFT) {
             // player->SetPosition(curpos - motion_increment * 2 * player->GetRight());
             player->SetVelocity(player->GetVelocity() - motion_increment * 5 * player->GetRight());
         }
-        if (glfwGetKey(window_, GLFW_KEY_Z) == GLFW_PRESS) {
+        if (keys & INPUT_NUDGE_LEFT) {
             player->SetPosition(curpos - motion_increment * 2 * player->GetRight());
         }
-        if (glfwGetKey(window_, GLFW_KEY_C) == GLFW_PRESS) {
+        if (keys & INPUT_NUDGE_RIGHT) {
             player->SetPosition(curpos + motion_increment * player->GetRight());
         }
-        if (glfwGetKey(window_, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+        if ((keys & INPUT_QUIT) && window_) {
             glfwSetWindowShouldClose(window_, true);
         }
-        if (glfwGetKey(window_, GLFW_KEY_Q) == GLFW_PRESS) {
+        if (keys & INPUT_TURN_LEFT) {
             player->SetAngle(angle + angle_increment);
 
         }
-        if (glfwGetKey(window_, GLFW_KEY_E) == GLFW_PRESS) {
+        if (keys & INPUT_TURN_RIGHT) {
             player->SetAngle(angle - angle_increment);
         }
 
-        if (glfwGetKey(window_, GLFW_KEY_R) == GLFW_PRESS) {    //makes it so you can only switch every 600ms
+        if (keys & INPUT_SWITCH_WEAPON) {    //makes it so you can only switch every 600ms
 
-            current_time = std::chrono::system_clock::now();
+            current_time = SimClock::now();
 
-            if (first_switch || current_time > last_switch_time + std::chrono::milliseconds(600)) {
+            if (first_switch_ || current_time > last_switch_time_ + std::chrono::milliseconds(600)) {
                 player->IncrementWeaponType();
 
-                last_switch_time = std::chrono::system_clock::now();
-                first_switch = false;
+                last_switch_time_ = SimClock::now();
+                first_switch_ = false;
             }
         }
 
-        if (glfwGetKey(window_, GLFW_KEY_F) == GLFW_PRESS) {
+        if (keys & INPUT_FIRE) {
             //Create a bullet
             //Edit all of its properties so it fires correctly
             //Push bullet
             //Call update
-            current_time = std::chrono::system_clock::now();
+            current_time = SimClock::now();
 
             if (player->GetWeaponType() == 1) {
-                if (first_bullet || current_time > last_bullet_time + std::chrono::milliseconds(850)) {
+                if (first_bullet_ || current_time > last_bullet_time_ + std::chrono::milliseconds(850)) {
                     GameObject* bullet = new GameObject(player->GetPosition(), sprite_, &sprite_shader_, tex_[5]);
 
 
@@ -918,8 +1691,9 @@ namespace game {
 
 
                     // Setup particle system
-                    GameObject* particles = new ParticleSystem(glm::vec3(0.0f, -0.3f, 0.0f), particles2_, &particle_shader2_, tex_[4], game_objects_[1]);
+                    ParticleSystem* particles = new ParticleSystem(glm::vec3(0.0f, -0.3f, 0.0f), particles2_, &particle_shader_, tex_[4], game_objects_[1], effect_style_g);
                     particles->SetScale(0.2);
+                    AttachEmitter(particles);
                     game_objects_.push_back(particles);
 
 
@@ -927,8 +1701,8 @@ namespace game {
 
                     bullet->Update(delta_time);
 
-                    last_bullet_time = std::chrono::system_clock::now();
-                    first_bullet = false;
+                    last_bullet_time_ = SimClock::now();
+                    first_bullet_ = false;
 
 
                 }
@@ -936,7 +1710,7 @@ namespace game {
 
             if (player->GetWeaponType() == 2) {         //sometimes edges of aoe sprite do not count as a connection
 
-                if (first_aoe || current_time > last_aoe_time + std::chrono::milliseconds(2000)) {
+                if (first_aoe_ || current_time > last_aoe_time_ + std::chrono::milliseconds(2000)) {
                     GameObject* aoe = new GameObject(player->GetPosition(), sprite_, &sprite_shader_, tex_[7]); //need to change texture 
 
                     aoe->SetScale(1.5);
@@ -951,13 +1725,13 @@ namespace game {
 
                     aoe->Update(delta_time);
 
-                    last_aoe_time = std::chrono::system_clock::now();
-                    first_aoe = false;
+                    last_aoe_time_ = SimClock::now();
+                    first_aoe_ = false;
                 }
             }
 
             if (player->GetWeaponType() == 3) {
-                if (first_minigun || current_time > last_minigun_time + std::chrono::milliseconds(200)) {
+                if (first_minigun_ || current_time > last_minigun_time_ + std::chrono::milliseconds(200)) {
                     if (minigunAmmoCount > 0) {
                         GameObject* minigun = new GameObject(player->GetPosition(), sprite_, &sprite_shader_, tex_[8]); //need to change texture 
 
@@ -973,8 +1747,8 @@ namespace game {
 
                         minigun->Update(delta_time);
 
-                        last_minigun_time = std::chrono::system_clock::now();
-                        first_minigun = false;
+                        last_minigun_time_ = SimClock::now();
+                        first_minigun_ = false;
                         minigunAmmoCount--;
                     }
                 }
@@ -8,6 +8,16 @@
 
 #include "shader.h"
 #include "game_object.h"
+#include "particle_system.h"
+#include "particles.h"
+#include "input.h"
+#include "frame_pacer.h"
+#include "render_queue.h"
+#include "texture_atlas.h"
+#include "frame_uniforms.h"
+#include "gpu_particles.h"
+#include "particle_budget.h"
+#include "particle_target.h"
 
 namespace game {
 
@@ -23,15 +33,58 @@ namespace game {
             // Initialize graphics libraries and main window
             void Init(void); 
 
+            // Alternative to Init() for running the simulation without a
+            // window or OpenGL context (benchmarks, machines without a GPU)
+            void InitHeadless(void);
+
             // Set up the game (scene, game objects, etc.)
             void Setup(void);
 
             // Run the game (keep the game active)
             void MainLoop(void); 
 
+            // Choose how MainLoop waits between frames (vsync by default)
+            void SetFramePacing(PacingMode mode, double frames_per_second);
+
+            // Choose how GPU particles are simulated (transform feedback by
+            // default); call before Init
+            void SetParticleBackend(ParticleBackend backend);
+
+            // Choose how the animated particle geometry is stored
+            // (procedural by default); call before Init
+            void SetParticleLayout(ParticleLayout layout);
+
+            // Draw particles at 1/divisor of the window's resolution (1 by
+            // default, or 2 or 4) and add them over the sprites; call before Init
+            void SetParticleResolution(int divisor);
+
+            // Run a fixed number of simulation ticks as fast as possible,
+            // then print a performance report. Requires InitHeadless()
+            // When replaying, the log decides the number and length of ticks
+            void RunHeadless(int ticks, double delta_time);
+
+            // Write every tick's input to a log while the game runs
+            // Call after the run seed is set, since the log stores it
+            void StartRecording(const std::string &path);
+
+            // Play back a recorded input log instead of reading the keyboard
+            // Also sets the run seed to the recorded one, so call before Init
+            void StartReplay(const std::string &path);
+
+            // Write the whole world (objects, timers, random streams) to a
+            // binary snapshot, or replace the current world with a saved one
+            // Loading requires Setup() to have been called
+            void SaveSnapshot(const std::string &path);
+            void LoadSnapshot(const std::string &path);
+
         private:
             // Main window: pointer to the GLFW window structure
+            // Stays null when running headless
             GLFWwindow *window_;
+            bool headless_;
+
+            // How Init() stores the particle geometry
+            ParticleLayout particle_layout_;
 
             // Sprite geometry
             Geometry *sprite_;
@@ -39,50 +92,129 @@ namespace game {
             // Particle geometry
             Geometry *particles_;
             Geometry *particles2_;
-            Geometry* particles3_;
+
+            // Prebuilt explosion geometries, handed out in turn, and emitters
+            // that finished exploding, kept to be reused by later kills
+#define NUM_EXPLOSION_GEOMETRIES 4
+#define EXPLOSION_POOL_SIZE 16
+            Geometry *explosions_[NUM_EXPLOSION_GEOMETRIES];
+            int next_explosion_;
+            std::vector<ParticleSystem*> explosion_pool_;
+
+            // Simulates the engine, explosion and bullet trail particles on the GPU
+            GpuParticleEngine particle_engine_;
+
+            // Particles the systems in view share each frame
+            ParticleBudget particle_budget_;
+
+            // Where the particles are drawn before being added to the window
+            ParticleTarget particle_target_;
 
 
             // Shader for rendering sprites in the scene
             Shader sprite_shader_;
 
-            // Shader for rendering particles
+            // Sorts each frame's draws by state and draws them
+            RenderQueue render_queue_;
+
+            // View, camera and time shared by all shaders, written once per frame
+            FrameUniforms frame_uniforms_;
+
+            // Rendering totals over the run, reported when the game exits
+            long frames_rendered_;
+            long objects_drawn_;
+            long objects_culled_;
+            long draw_calls_;
+            long state_changes_;
+            long particles_batched_;
+
+            // Shader for rendering particles (every kind, see ParticleStyle)
             Shader particle_shader_;
-            Shader particle_shader2_;
 
 
             // References to textures
 #define NUM_TEXTURES 20
             GLuint tex_[NUM_TEXTURES];
 
+            // Sprite images packed into shared pages, looked up by their tex_ name
+            TextureAtlas atlas_;
+
             // List of game objects
             std::vector<GameObject*> game_objects_;
 
             // Keep track of time
             double current_time_;
 
+            // Timers for enemy waves and collectibles
+            SimClock::time_point last_spawn_time_, last_collectible_time_;
+            bool first_wave_, first_collectible_;
+            int waves_since_speedup_;
+
+            // Cooldowns for the menu key, weapon switching and each weapon
+            SimClock::time_point last_tab_time_, last_switch_time_, last_bullet_time_, last_aoe_time_, last_minigun_time_;
+            bool first_tab_, first_switch_, first_bullet_, first_aoe_, first_minigun_;
+
+            // Waits between frames and measures the frame times
+            FramePacer pacer_;
+
+            // Input log being written and/or played back
+            InputRecorder recorder_;
+            InputPlayback playback_;
+
+            // Wall time spent in each part of a tick, for the benchmark report
+            enum SimSystem { SYS_SPAWN, SYS_INPUT, SYS_UPDATE, SYS_COLLISION, SYS_RENDER, NUM_SIM_SYSTEMS };
+            double system_time_[NUM_SIM_SYSTEMS];
+
             //It's probably easier to have a seperate function for collision
             bool RayCollision(glm::vec3 start, glm::vec3 direction, glm::vec3 center, float radius);
 
+            //Spawn enemy waves and collectibles when their timers run out
+            void Spawn(void);
+
             //New function for enemy spawning over time
             void SpawnEnemies(glm::vec3 playerPos);
 
             //Function to randomly spawn collectibles
             void SpawnCollectibles(glm::vec3 playerPos);
 
+            // Explosions: no allocation or buffer upload once the pool is warm
+            Geometry *NextExplosionGeometry(void);
+            bool IsExplosion(GameObject *object);
+            ParticleSystem *SpawnExplosion(GameObject *parent);
+
+            // Give the engine flame, explosions and trails a GPU emitter;
+            // false if the system is of another kind or all emitters are
+            // taken, in which case it keeps drawing its geometry
+            bool AttachEmitter(ParticleSystem *system);
+
+            // How the particles of systems drawing the given geometry look
+            ParticleStyle StyleFor(Geometry *geom);
+
+            // Snapshot ids for the shared resources objects point to
+            int GeometryId(Geometry *geom);
+            Geometry *GeometryFromId(int id);
+            int ShaderId(Shader *shader);
+            Shader *ShaderFromId(int id);
+            int TextureId(GLuint texture);
+            GLuint TextureFromId(int id);
+
             // Callback for when the window is resized
             static void ResizeCallback(GLFWwindow* window, int width, int height);
 
-            // Set a specific texture
-            void SetTexture(GLuint w, const char *fname);
+            // Set a specific texture, as a 2D texture or a one-layer array
+            void SetTexture(GLuint w, const char *fname, GLenum target = GL_TEXTURE_2D);
 
             // Load all textures
             void SetAllTextures();
 
-            // Handle user input
-            void Controls(double delta_time);
+            // Handle user input (a mask of InputKey bits)
+            void Controls(double delta_time, uint16_t keys);
 
             // Update the game based on user input and simulation
-            void Update(glm::mat4 view_matrix, double delta_time);
+            void Update(double delta_time, uint16_t keys);
+
+            // Draw all game objects from the camera that follows the player
+            void Render(glm::mat4 view_matrix);
 
     }; // class Game
 
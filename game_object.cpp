@@ -1,5 +1,6 @@
 #define GLM_FORCE_RADIANS
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 #include <iostream>
 
 #include "game_object.h"
@@ -26,7 +27,7 @@ GameObject::GameObject(const glm::vec3 &position, Geometry *geom, Shader *shader
     isDead_ = false;
     isBg_ = false;  //to distinguish background easily
     mustDie_ = false;
-    current_time_ = std::chrono::system_clock::now();
+    current_time_ = SimClock::now();
     
     //I set this to the really high value of 100, but in reality
     //the code always forces you to change it anyway
@@ -42,6 +43,7 @@ GameObject::GameObject(const glm::vec3 &position, Geometry *geom, Shader *shader
     health_ = 5;
 
     //for enemy
+    state_ = 0;
     radius_ = 1.0f;
     speed_ = 0.2f;
     centre_ = position_;
@@ -144,13 +146,13 @@ void GameObject::Update(double delta_time) {
 
         if (position_.y < player_pos_.y - 2) {
             Kill();
-            std::cout << "Killed offsceen" << std::endl;
+            //std::cout << "Killed offsceen" << std::endl;
         }
         
     }
     // Update object position with Euler integration
     position_ += velocity_ * ((float) delta_time);
-    current_time_ = std::chrono::system_clock::now();
+    current_time_ = SimClock::now();
     
     //I constantly update the time and if the conditions are true, "kill" the object
     if (mustDie_ && current_time_ > death_time_) {
@@ -282,6 +284,65 @@ void GameObject::Fire() {
 }
 
 
+void GameObject::Save(BinaryWriter &out) {
+    out.Write<glm::vec3>(position_);
+    out.Write<float>(scale_);
+    out.Write<float>(angle_);
+    out.Write<glm::vec3>(velocity_);
+    out.WriteString(type_);
+    out.Write<bool>(isDead_);
+    out.Write<bool>(mustDie_);
+    out.Write<bool>(enemyCanFire);
+    out.WriteTime(current_time_);
+    out.WriteTime(death_time_);
+    out.WriteTime(invincible_time_);
+    out.WriteTime(fire_time_);
+    out.Write<bool>(isChild_);
+    out.Write<int>(killCount_);
+    out.Write<int>(health_);
+    out.Write<int>(stars_collected_);
+    out.Write<int>(state_);
+    out.Write<float>(radius_);
+    out.Write<float>(speed_);
+    out.Write<glm::vec3>(centre_);
+    out.Write<glm::vec3>(player_pos_);
+    out.Write<int>(weaponType_);
+    out.Write<bool>(isBg_);
+    out.Write<bool>(ghost_);
+    out.Write<int>(burst_);
+}
+
+
+void GameObject::Load(BinaryReader &in) {
+    // Same order as Save()
+    position_ = in.Read<glm::vec3>();
+    scale_ = in.Read<float>();
+    angle_ = in.Read<float>();
+    velocity_ = in.Read<glm::vec3>();
+    type_ = in.ReadString();
+    isDead_ = in.Read<bool>();
+    mustDie_ = in.Read<bool>();
+    enemyCanFire = in.Read<bool>();
+    current_time_ = in.ReadTime<SimClock::time_point>();
+    death_time_ = in.ReadTime<SimClock::time_point>();
+    invincible_time_ = in.ReadTime<SimClock::time_point>();
+    fire_time_ = in.ReadTime<SimClock::time_point>();
+    isChild_ = in.Read<bool>();
+    killCount_ = in.Read<int>();
+    health_ = in.Read<int>();
+    stars_collected_ = in.Read<int>();
+    state_ = in.Read<int>();
+    radius_ = in.Read<float>();
+    speed_ = in.Read<float>();
+    centre_ = in.Read<glm::vec3>();
+    player_pos_ = in.Read<glm::vec3>();
+    weaponType_ = in.Read<int>();
+    isBg_ = in.Read<bool>();
+    ghost_ = in.Read<bool>();
+    burst_ = in.Read<int>();
+}
+
+
 void GameObject::LookAtPlayer() {
     //handles enemies turning at the player
     //Changes their dir based on playerpos to keep it brief
@@ -292,51 +353,36 @@ void GameObject::LookAtPlayer() {
 }
 
 
-void GameObject::Render(glm::mat4 view_matrix, double current_time){
-
-    // Set up the shader
-    shader_->Enable();
-
-    // Set up the view matrix
-    shader_->SetUniformMat4("view_matrix", view_matrix);
+void GameObject::GetBounds(glm::vec2 &center, float &radius){
 
-    // Setup the scaling matrix for the shader
-    glm::mat4 scaling_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(scale_, scale_, 1.0));
-
-    // Setup the rotation matrix for the shader
-    glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), angle_, glm::vec3(0.0, 0.0, 1.0));
-
-    // Set up the translation matrix for the shader
-    glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), position_);
+    // The unit quad's corners are sqrt(0.5) from its centre, at any angle
+    center = glm::vec2(position_.x, position_.y);
+    radius = 0.7072f * scale_;
+}
 
-    // Setup the transformation matrix for the shader
-    glm::mat4 transformation_matrix = translation_matrix * rotation_matrix * scaling_matrix;
 
-    // Set the transformation matrix in the shader
-    shader_->SetUniformMat4("transformation_matrix", transformation_matrix);
+void GameObject::Render(RenderQueue &queue, double current_time){
 
-    // Set up the geometry
-    geometry_->SetGeometry(shader_->GetShaderProgram());
+    SpriteInstance instance;
+    instance.position = glm::vec2(position_.x, position_.y);
+    instance.angle = angle_;
+    instance.scale = scale_;
+    instance.tint = glm::packUnorm4x8(glm::vec4(1.0f, 1.0f, 1.0f, 1.0f));
+    instance.layer = 0.0f;
 
     if (this->isBg_ == true) {
-        shader_->SetUniform1f("x", 140.0);   //when it is a background the x value goes up so that the background doesnt look stretched and values are properly interpolated      
+        instance.uv_rect = glm::vec4(0.0f, 0.0f, 140.0f, 140.0f);   //when it is a background the uvs go up so that the background doesnt look stretched and values are properly interpolated
     }
     else {
-        shader_->SetUniform1f("x", 1.0);
+        instance.uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
     }
 
     if (ghost_ && type_ == "player") {
-        glBindTexture(GL_TEXTURE_2D, gold_texture_);
+        queue.AddSprite(shader_, gold_texture_, instance);
     }
     else {
-        glBindTexture(GL_TEXTURE_2D, texture_);
+        queue.AddSprite(shader_, texture_, instance);
     }
-    
-
-    
-
-    // Draw the entity
-    glDrawElements(GL_TRIANGLES, geometry_->GetSize(), GL_UNSIGNED_INT, 0);
 }
 
 } // namespace game
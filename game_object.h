@@ -13,6 +13,9 @@
 
 #include "shader.h"
 #include "geometry.h"
+#include "sim_clock.h"
+#include "binary_io.h"
+#include "render_queue.h"
 
 namespace game {
 
@@ -28,16 +31,29 @@ namespace game {
             // Constructor
             GameObject(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture);
 
+            // Objects are deleted through GameObject pointers
+            virtual ~GameObject() {}
+
             // Update the GameObject's state. Can be overriden in children
             virtual void Update(double delta_time);
 
-            // Renders the GameObject 
-            virtual void Render(glm::mat4 view_matrix, double current_time);
+            // Renders the GameObject by adding it to the frame's render queue
+            virtual void Render(RenderQueue &queue, double current_time);
+
+            // Bounding circle of what Render draws, in world space, for culling
+            virtual void GetBounds(glm::vec2 &center, float &radius);
+
             void LookAtPlayer();
 
             void InitFiring(Geometry* geom, Shader* shader, GLuint texture, std::vector<GameObject*>& vec, int type);
             void Fire();
 
+            // Snapshots: write or read this object's own state
+            // Pointers (geometry, shader, textures, parent) are not included,
+            // the Game saves those as ids and restores them with the setters below
+            virtual void Save(BinaryWriter &out);
+            virtual void Load(BinaryReader &in);
+
             // Getters
             inline glm::vec3& GetPosition(void) { return position_; }
             inline float GetScale(void) { return scale_; }
@@ -54,6 +70,15 @@ namespace game {
             inline bool CheckIfChild(void) { return isChild_; }
             inline std::string GetType(void) { return type_; }
             inline bool isBackground(void) { return isBg_; }
+            inline Geometry* GetGeometry(void) { return geometry_; }
+            inline Shader* GetShader(void) { return shader_; }
+            inline GLuint GetTexture(void) { return texture_; }
+            inline GLuint GetGoldTexture(void) { return gold_texture_; }
+            inline GameObject* GetParent(void) { return parent_; }
+            inline bool CanFire(void) { return enemyCanFire; }
+            inline Geometry* GetBulletGeometry(void) { return geometryBullet_; }
+            inline Shader* GetBulletShader(void) { return shaderBullet_; }
+            inline GLuint GetBulletTexture(void) { return textureBullet_; }
             // Get bearing direction (direction in which the game object
             // is facing)
             glm::vec3 GetBearing(void);
@@ -113,7 +138,7 @@ namespace game {
             //the value of time doesn't matter
             inline void SetMustDie(bool die, int time) { 
                 mustDie_ = die;
-                current_time_ = std::chrono::system_clock::now();
+                current_time_ = SimClock::now();
                 death_time_ = current_time_ + std::chrono::seconds(time);
             }
 
@@ -139,6 +164,9 @@ namespace game {
                 isChild_ = true;
             }
 
+            // Relink the parent after loading a snapshot (isChild_ is part of the saved state)
+            inline void RestoreParent(GameObject* parent) { parent_ = parent; }
+
             inline void Kill() { isDead_ = true; }
 
             //for enemy
@@ -184,9 +212,9 @@ namespace game {
            
 
             //These will track when to kill the object
-            std::chrono::time_point<std::chrono::system_clock> current_time_, death_time_, invincible_time_;
+            SimClock::time_point current_time_, death_time_, invincible_time_;
             
-            std::chrono::time_point<std::chrono::system_clock> fire_time_;
+            SimClock::time_point fire_time_;
 
             //Need this to do hierarchy transforms
             GameObject* parent_;
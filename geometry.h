@@ -3,6 +3,9 @@
 
 #define GLEW_STATIC
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "shader.h"
 
 namespace game {
 
@@ -14,10 +17,28 @@ namespace game {
             Geometry(void) {};
 
             // Create the geometry (called once)
+            // Also records the attribute layout in a vertex array object
             virtual void CreateGeometry(void) {};
 
+            // Point the attribute slots of the bound vertex array at the
+            // geometry's buffers (used when creating vertex arrays)
+            virtual void SetAttributes(void) {};
+
             // Use the geometry
-            virtual void SetGeometry(GLuint shader_program) {};
+            inline void SetGeometry(void) { glBindVertexArray(vao_); }
+
+            // Draw the bound geometry; geometry made of independent parts
+            // (particles) draws only the given fraction of them, the rest
+            // always draws everything
+            virtual void Draw(float /*detail*/ = 1.0f) { glDrawElements(GL_TRIANGLES, size_, GL_UNSIGNED_INT, 0); }
+
+            // Draw count copies of the whole bound geometry in one call; the
+            // shader tells them apart by the instance number
+            virtual void DrawBatch(int count) { glDrawElementsInstanced(GL_TRIANGLES, size_, GL_UNSIGNED_INT, 0, count); }
+
+            // Values the particle vertex shaders need to generate the
+            // vertices themselves, zeros for geometry kept in buffers
+            virtual glm::vec4 GetProcedural(void) { return glm::vec4(0.0f); }
             
             //set the particle effect to use explosion code
             inline void SetExplode(bool temp) { isExplosion_ = temp; }
@@ -28,7 +49,8 @@ namespace game {
             inline void SetRange(float range) { range_ = range; }
 
         protected:
-            // Geometry buffers
+            // Geometry buffers and the vertex array that describes them
+            GLuint vao_;
             GLuint vbo_;
             GLuint ebo_;
             int size_;
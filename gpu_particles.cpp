@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <vector>
+#include <iostream>
+
+#include "render_state.h"
+#include "gpu_particles.h"
+
+namespace game {
+
+// A particle record: position and velocity, then age, lifetime and emitter
+static const int particle_floats_g = 7;
+
+// Emitters stay reserved this long after their particles' lifetime, so
+// both buffers have seen them die before the slots are handed out again
+static const float release_margin_g = 0.25f;
+
+// Invocations per work group in the compute shaders
+static const int compute_group_size_g = 256;
+
+
+GpuParticleEngine::GpuParticleEngine(void)
+{
+    for (int i = 0; i < MAX_EMITTERS; i++) {
+        emitters_[i].used = false;
+        transforms_[i] = glm::vec4(0.0f);
+        spawns_[i] = glm::vec4(0.0f);
+        motions_[i] = glm::vec4(0.0f);
+        tints_[i] = glm::vec4(0.0f);
+    }
+    initialized_ = false;
+    quad_ = nullptr;
+    step_ = 0;
+    current_ = 0;
+    backend_ = PARTICLES_FEEDBACK;
+    particle_ssbo_ = 0;
+    free_list_ssbo_ = 0;
+    draw_ssbo_ = 0;
+    alive_ssbo_ = 0;
+    compute_vao_ = 0;
+}
+
+
+GpuParticleEngine::~GpuParticleEngine()
+{
+    // Never initialized (e.g., headless runs have no OpenGL context)
+    if (!initialized_) {
+        return;
+    }
+
+    if (backend_ == PARTICLES_COMPUTE) {
+        GLuint buffers[] = { particle_ssbo_, free_list_ssbo_, draw_ssbo_, alive_ssbo_ };
+        glDeleteBuffers(4, buffers);
+        glDeleteVertexArrays(1, &compute_vao_);
+        return;
+    }
+
+    glDeleteVertexArrays(2, update_vao_);
+    glDeleteVertexArrays(2, render_vao_);
+    glDeleteBuffers(2, buffers_);
+}
+
+
+void GpuParticleEngine::Init(Geometry *quad, const std::string &shader_directory)
+{
+    quad_ = quad;
+
+    // Before 4.3 the compute path also needs storage buffers and indirect
+    // draws, which are separate extensions
+    bool compute = GLEW_VERSION_4_3 ||
+        (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_draw_indirect);
+    if (backend_ == PARTICLES_COMPUTE && !compute) {
+        std::cout << "Compute shaders are not available, using transform feedback for particles" << std::endl;
+        backend_ = PARTICLES_FEEDBACK;
+    }
+
+    if (backend_ == PARTICLES_COMPUTE) {
+        InitCompute(shader_directory);
+    }
+    else {
+        InitFeedback(shader_directory);
+    }
+    std::cout << "GPU particles: " << (backend_ == PARTICLES_COMPUTE ? "compute" : "transform feedback") << std::endl;
+
+    initialized_ = true;
+}
+
+
+void GpuParticleEngine::InitFeedback(const std::string &shader_directory)
+{
+    const char *varyings[] = { "next_particle", "next_particle_age" };
+    update_shader_.Init((shader_directory + "/particle_update.glsl").c_str(), NULL, varyings, 2);
+    delta_time_uniform_ = update_shader_.GetUniform<float>("delta_time");
+    seed_uniform_ = update_shader_.GetUniform<float>("seed");
+    update_slots_uniform_ = update_shader_.GetUniform<int>("slots_per_emitter");
+    transform_uniform_ = update_shader_.GetUniform<glm::vec4>("emitter_transform");
+    spawn_uniform_ = update_shader_.GetUniform<glm::vec4>("emitter_spawn");
+    motion_uniform_ = update_shader_.GetUniform<glm::vec4>("emitter_motion");
+
+    render_shader_.Init((shader_directory + "/particle_gpu_vertex.glsl").c_str(), (shader_directory + "/particle_gpu_fragment.glsl").c_str());
+    tint_uniform_ = render_shader_.GetUniform<glm::vec4>("emitter_tint");
+
+    // All zeros: every slot starts free (age 0 is not below lifetime 0)
+    std::vector<GLfloat> zeros(MAX_EMITTERS * PARTICLES_PER_EMITTER * particle_floats_g, 0.0f);
+    GLsizei stride = particle_floats_g * sizeof(GLfloat);
+
+    glGenBuffers(2, buffers_);
+    glGenVertexArrays(2, update_vao_);
+    glGenVertexArrays(2, render_vao_);
+    for (int i = 0; i < 2; i++) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffers_[i]);
+        glBufferData(GL_ARRAY_BUFFER, zeros.size() * sizeof(GLfloat), zeros.data(), GL_DYNAMIC_COPY);
+
+        // Updating reads one record per vertex
+        glBindVertexArray(update_vao_[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, buffers_[i]);
+        glVertexAttribPointer(ATTRIB_PARTICLE, 4, GL_FLOAT, GL_FALSE, stride, 0);
+        glVertexAttribPointer(ATTRIB_PARTICLE_AGE, 3, GL_FLOAT, GL_FALSE, stride, (void *)(4 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(ATTRIB_PARTICLE);
+        glEnableVertexAttribArray(ATTRIB_PARTICLE_AGE);
+
+        // Drawing reads one record per quad
+        glBindVertexArray(render_vao_[i]);
+        quad_->SetAttributes();
+        glBindBuffer(GL_ARRAY_BUFFER, buffers_[i]);
+        glVertexAttribPointer(ATTRIB_PARTICLE, 4, GL_FLOAT, GL_FALSE, stride, 0);
+        glVertexAttribPointer(ATTRIB_PARTICLE_AGE, 3, GL_FLOAT, GL_FALSE, stride, (void *)(4 * sizeof(GLfloat)));
+        glEnableVertexAttribArray(ATTRIB_PARTICLE);
+        glEnableVertexAttribArray(ATTRIB_PARTICLE_AGE);
+        glVertexAttribDivisor(ATTRIB_PARTICLE, 1);
+        glVertexAttribDivisor(ATTRIB_PARTICLE_AGE, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+void GpuParticleEngine::InitCompute(const std::string &shader_directory)
+{
+    emit_shader_.InitCompute((shader_directory + "/particle_emit.glsl").c_str());
+    emit_seed_uniform_ = emit_shader_.GetUniform<float>("seed");
+    spawn_total_uniform_ = emit_shader_.GetUniform<int>("spawn_total");
+    emit_transform_uniform_ = emit_shader_.GetUniform<glm::vec4>("emitter_transform");
+    emit_spawn_uniform_ = emit_shader_.GetUniform<glm::vec4>("emitter_spawn");
+
+    simulate_shader_.InitCompute((shader_directory + "/particle_simulate.glsl").c_str());
+    simulate_delta_time_uniform_ = simulate_shader_.GetUniform<float>("delta_time");
+    capacity_uniform_ = simulate_shader_.GetUniform<int>("capacity");
+    simulate_motion_uniform_ = simulate_shader_.GetUniform<glm::vec4>("emitter_motion");
+
+    compute_render_shader_.Init((shader_directory + "/particle_compute_vertex.glsl").c_str(), (shader_directory + "/particle_gpu_fragment.glsl").c_str());
+    compute_tint_uniform_ = compute_render_shader_.GetUniform<glm::vec4>("emitter_tint");
+
+    // Two vec4s per record, all zeros: every record starts dead
+    std::vector<GLfloat> zeros(COMPUTE_PARTICLE_CAPACITY * 8, 0.0f);
+    glGenBuffers(1, &particle_ssbo_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, particle_ssbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, zeros.size() * sizeof(GLfloat), zeros.data(), GL_DYNAMIC_COPY);
+
+    // The free list starts with every record on it: a count, then the indices
+    std::vector<GLuint> free_list(COMPUTE_PARTICLE_CAPACITY + 1);
+    free_list[0] = COMPUTE_PARTICLE_CAPACITY;
+    for (int i = 0; i < COMPUTE_PARTICLE_CAPACITY; i++) {
+        free_list[i + 1] = (GLuint)i;
+    }
+    glGenBuffers(1, &free_list_ssbo_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, free_list_ssbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, free_list.size() * sizeof(GLuint), free_list.data(), GL_DYNAMIC_COPY);
+
+    // Indirect draw of the quad, the simulate pass fills in the instance count
+    GLuint command[] = { (GLuint)quad_->GetSize(), 0, 0, 0, 0 };
+    glGenBuffers(1, &draw_ssbo_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_ssbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(command), command, GL_DYNAMIC_COPY);
+
+    glGenBuffers(1, &alive_ssbo_);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, alive_ssbo_);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, COMPUTE_PARTICLE_CAPACITY * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    // Drawing reads the records from storage buffers, only the quad is an attribute
+    glGenVertexArrays(1, &compute_vao_);
+    glBindVertexArray(compute_vao_);
+    quad_->SetAttributes();
+    glBindVertexArray(0);
+}
+
+
+int GpuParticleEngine::CreateEmitter(const EmitterParams &params)
+{
+    for (int i = 0; i < MAX_EMITTERS; i++) {
+        if (!emitters_[i].used) {
+            Emitter &emitter = emitters_[i];
+            emitter.used = true;
+            emitter.released = false;
+            emitter.time_released = 0.0f;
+            emitter.params = params;
+            emitter.position = glm::vec2(0.0f, 0.0f);
+            emitter.last_position = glm::vec2(0.0f, 0.0f);
+            emitter.placed = false;
+            emitter.angle = 0.0f;
+            emitter.detail = 1.0f;
+            emitter.pending = 0.0f;
+            emitter.burst = 0;
+            emitter.cursor = 0;
+            return i;
+        }
+    }
+    return -1;
+}
+
+
+void GpuParticleEngine::SetEmitterTransform(int emitter, const glm::vec2 &position, float angle)
+{
+    emitters_[emitter].position = position;
+    emitters_[emitter].angle = angle;
+
+    // Nothing to follow before the first placement
+    if (!emitters_[emitter].placed) {
+        emitters_[emitter].last_position = position;
+        emitters_[emitter].placed = true;
+    }
+}
+
+
+void GpuParticleEngine::SetSpawnRate(int emitter, float rate)
+{
+    emitters_[emitter].params.rate = rate;
+}
+
+
+void GpuParticleEngine::SetEmitterDetail(int emitter, float detail)
+{
+    emitters_[emitter].detail = detail;
+}
+
+
+int GpuParticleEngine::GetEmitterDemand(int emitter) const
+{
+    const EmitterParams &params = emitters_[emitter].params;
+    return (int)(params.rate * params.lifetime);
+}
+
+
+void GpuParticleEngine::Burst(int emitter, int count)
+{
+    emitters_[emitter].burst += count;
+}
+
+
+void GpuParticleEngine::ReleaseEmitter(int emitter)
+{
+    emitters_[emitter].released = true;
+    emitters_[emitter].time_released = 0.0f;
+}
+
+
+int GpuParticleEngine::GetEmitterCount(void) const
+{
+    int count = 0;
+    for (int i = 0; i < MAX_EMITTERS; i++) {
+        if (emitters_[i].used) {
+            count++;
+        }
+    }
+    return count;
+}
+
+
+int GpuParticleEngine::GetActiveSlotCount(void) const
+{
+    for (int i = MAX_EMITTERS - 1; i >= 0; i--) {
+        if (emitters_[i].used) {
+            return (i + 1) * PARTICLES_PER_EMITTER;
+        }
+    }
+    return 0;
+}
+
+
+void GpuParticleEngine::Update(float delta_time)
+{
+    // Work out each emitter's spawn window on the CPU: a start slot and a
+    // count, or with compute its first emit invocation and a count
+    int spawn_total = 0;
+    for (int i = 0; i < MAX_EMITTERS; i++) {
+        Emitter &emitter = emitters_[i];
+        spawns_[i] = glm::vec4(0.0f);
+        if (!emitter.used) {
+            continue;
+        }
+
+        if (emitter.released) {
+            emitter.time_released += delta_time;
+            if (emitter.time_released > emitter.params.lifetime + release_margin_g) {
+                emitter.used = false;
+                continue;
+            }
+        }
+        else {
+            emitter.pending += emitter.params.rate * emitter.detail * delta_time;
+        }
+
+        // The shared compute pool is not limited to the emitter's slots
+        int count = (int)emitter.pending;
+        emitter.pending -= count;
+        count += emitter.burst;
+        if (backend_ == PARTICLES_FEEDBACK) {
+            count = std::min(count, PARTICLES_PER_EMITTER);
+        }
+        emitter.burst = 0;
+
+        const EmitterParams &params = emitter.params;
+        glm::vec2 moved = params.follow * (emitter.position - emitter.last_position);
+        emitter.last_position = emitter.position;
+        float first = (backend_ == PARTICLES_COMPUTE) ? (float)spawn_total : (float)emitter.cursor;
+
+        transforms_[i] = glm::vec4(emitter.position, emitter.angle, params.spread);
+        spawns_[i] = glm::vec4(first, (float)count, params.speed, params.lifetime);
+        motions_[i] = glm::vec4(params.gravity, params.drag, moved);
+        tints_[i] = glm::vec4(params.color, params.size);
+        emitter.cursor = (emitter.cursor + count) % PARTICLES_PER_EMITTER;
+        spawn_total += count;
+    }
+
+    if (!initialized_) {
+        return;
+    }
+
+    if (backend_ == PARTICLES_COMPUTE) {
+        UpdateCompute(delta_time, spawn_total);
+    }
+    else {
+        UpdateFeedback(delta_time);
+    }
+}
+
+
+void GpuParticleEngine::UpdateFeedback(float delta_time)
+{
+    int slots = GetActiveSlotCount();
+    if (slots == 0) {
+        return;
+    }
+
+    update_shader_.Enable();
+    update_shader_.Set(delta_time_uniform_, delta_time);
+    update_shader_.Set(seed_uniform_, (float)(step_++ % 1024));
+    update_shader_.Set(update_slots_uniform_, PARTICLES_PER_EMITTER);
+    update_shader_.Set(transform_uniform_, transforms_, MAX_EMITTERS);
+    update_shader_.Set(spawn_uniform_, spawns_, MAX_EMITTERS);
+    update_shader_.Set(motion_uniform_, motions_, MAX_EMITTERS);
+
+    // One point per slot, nothing rasterized
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindVertexArray(update_vao_[current_]);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers_[1 - current_]);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, slots);
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glBindVertexArray(0);
+    glDisable(GL_RASTERIZER_DISCARD);
+
+    current_ = 1 - current_;
+}
+
+
+void GpuParticleEngine::UpdateCompute(float delta_time, int spawn_total)
+{
+    // Even with no emitters left, the records in flight still have to die
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particle_ssbo_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, free_list_ssbo_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, draw_ssbo_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, alive_ssbo_);
+
+    // The simulate pass counts the live records again
+    GLuint zero = 0;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, draw_ssbo_);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), sizeof(GLuint), &zero);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    if (spawn_total > 0) {
+        emit_shader_.Enable();
+        emit_shader_.Set(emit_seed_uniform_, (float)(step_ % 1024));
+        emit_shader_.Set(spawn_total_uniform_, spawn_total);
+        emit_shader_.Set(emit_transform_uniform_, transforms_, MAX_EMITTERS);
+        emit_shader_.Set(emit_spawn_uniform_, spawns_, MAX_EMITTERS);
+        glDispatchCompute((spawn_total + compute_group_size_g - 1) / compute_group_size_g, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    step_++;
+
+    simulate_shader_.Enable();
+    simulate_shader_.Set(simulate_delta_time_uniform_, delta_time);
+    simulate_shader_.Set(capacity_uniform_, COMPUTE_PARTICLE_CAPACITY);
+    simulate_shader_.Set(simulate_motion_uniform_, motions_, MAX_EMITTERS);
+    glDispatchCompute(COMPUTE_PARTICLE_CAPACITY / compute_group_size_g, 1, 1);
+
+    // The draw reads the records, the live list and the command
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+}
+
+
+void GpuParticleEngine::Draw(GLuint texture)
+{
+    if (!initialized_) {
+        return;
+    }
+
+    if (backend_ == PARTICLES_COMPUTE) {
+        DrawCompute(texture);
+        return;
+    }
+
+    int slots = GetActiveSlotCount();
+    if (slots == 0) {
+        return;
+    }
+
+    SetRenderPass(PASS_PARTICLES);
+    render_shader_.Enable();
+    render_shader_.Set(tint_uniform_, tints_, MAX_EMITTERS);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    glBindVertexArray(render_vao_[current_]);
+    glDrawElementsInstanced(GL_TRIANGLES, quad_->GetSize(), GL_UNSIGNED_INT, 0, slots);
+    glBindVertexArray(0);
+}
+
+
+void GpuParticleEngine::DrawCompute(GLuint texture)
+{
+    SetRenderPass(PASS_PARTICLES);
+    compute_render_shader_.Enable();
+    compute_render_shader_.Set(compute_tint_uniform_, tints_, MAX_EMITTERS);
+    glBindTexture(GL_TEXTURE_2D, texture);
+
+    // As many instances as the simulate pass listed, without reading it back
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, particle_ssbo_);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, alive_ssbo_);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, draw_ssbo_);
+    glBindVertexArray(compute_vao_);
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+} // namespace game
@@ -0,0 +1,180 @@
+#ifndef GPU_PARTICLES_H_
+#define GPU_PARTICLES_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+
+#include "shader.h"
+#include "geometry.h"
+
+// Must match MAX_EMITTERS in the GPU particle shaders
+#define MAX_EMITTERS 64
+#define PARTICLES_PER_EMITTER 1024
+#define COMPUTE_PARTICLE_CAPACITY 262144
+
+namespace game {
+
+    // How the particles are stepped on the GPU
+    enum ParticleBackend {
+        PARTICLES_FEEDBACK,     // Transform feedback, GL 3.0
+        PARTICLES_COMPUTE       // Compute shaders on storage buffers, GL 4.3
+    };
+
+    // How an emitter spawns and moves its particles
+    struct EmitterParams {
+        float rate;         // Particles per second while emitting
+        float speed;        // Initial speed, randomly down to half of it
+        float spread;       // Half angle of the emission cone (pi: all around)
+        float lifetime;     // Seconds, randomly down to half of it
+        float gravity;      // Downward acceleration
+        float drag;         // Fraction of the velocity lost per second
+        float follow;       // How much live particles move along with the emitter (0 to 1)
+        float size;         // Width of a particle
+        glm::vec3 color;
+    };
+
+    // Particles simulated on the GPU: every particle slot has a position,
+    // velocity, age and lifetime in a buffer, and each step a transform
+    // feedback pass reads one buffer and writes the next state into the
+    // other (ping-pong), so the CPU never touches a particle
+    //
+    // Each emitter owns a fixed run of PARTICLES_PER_EMITTER slots. Spawning
+    // writes new particles over the emitter's slots like a ring, so bursts
+    // and rates only cost a start slot and a count per emitter per step
+    //
+    // The compute backend keeps one pool of COMPUTE_PARTICLE_CAPACITY records
+    // in a storage buffer instead. An emit pass pops records off an atomic
+    // free list, and a simulate pass pushes dying records back and lists
+    // the live ones, which are drawn with an indirect call whose instance
+    // count the GPU wrote: emitters share the pool and bursts can be large
+    class GpuParticleEngine {
+
+        public:
+            GpuParticleEngine(void);
+            ~GpuParticleEngine();
+
+            // Choose the backend before Init(); compute falls back to
+            // transform feedback if the context has no compute shaders
+            inline void SetBackend(ParticleBackend backend) { backend_ = backend; }
+            inline ParticleBackend GetBackend(void) const { return backend_; }
+
+            // Create the buffers and load the shaders (needs an OpenGL context)
+            // quad is the unit quad drawn for every particle
+            void Init(Geometry *quad, const std::string &shader_directory);
+
+            // Emitters work without Init() (headless); they just never draw
+            // Returns -1 when all emitters are in use
+            int CreateEmitter(const EmitterParams &params);
+
+            // Where new particles start and the direction they leave in
+            void SetEmitterTransform(int emitter, const glm::vec2 &position, float angle);
+
+            // Change the rate, or spawn a number of particles on the next step
+            void SetSpawnRate(int emitter, float rate);
+
+            // Fraction of the spawn rate actually spawned (level of detail)
+            void SetEmitterDetail(int emitter, float detail);
+
+            // Particles an emitter keeps alive at full detail (rate * lifetime)
+            int GetEmitterDemand(int emitter) const;
+            void Burst(int emitter, int count);
+
+            // Stop spawning; the emitter is reused once its last particle is gone
+            void ReleaseEmitter(int emitter);
+
+            // Spawn, age and move every particle
+            void Update(float delta_time);
+
+            // Draw every live particle with additive blending
+            void Draw(GLuint texture);
+
+            // Emitters currently spawning or with live particles
+            int GetEmitterCount(void) const;
+
+        private:
+            struct Emitter {
+                bool used;
+                bool released;
+                float time_released;    // Seconds since ReleaseEmitter
+                EmitterParams params;
+                glm::vec2 position;
+                glm::vec2 last_position;  // Where it was on the previous step
+                bool placed;              // Has a position yet
+                float angle;
+                float detail;
+                float pending;          // Fraction of a particle owed by the rate
+                int burst;
+                int cursor;             // Next slot to spawn into
+            };
+
+            // Slots to process and draw: up to the last emitter in use
+            int GetActiveSlotCount(void) const;
+
+            // Create the buffers and programs of each backend
+            void InitFeedback(const std::string &shader_directory);
+            void InitCompute(const std::string &shader_directory);
+
+            // Run a step on the GPU, spawn_total being the particles to spawn
+            void UpdateFeedback(float delta_time);
+            void UpdateCompute(float delta_time, int spawn_total);
+            void DrawCompute(GLuint texture);
+
+            ParticleBackend backend_;
+
+            Emitter emitters_[MAX_EMITTERS];
+
+            // Per-emitter uniform arrays, refreshed every step
+            glm::vec4 transforms_[MAX_EMITTERS];
+            glm::vec4 spawns_[MAX_EMITTERS];
+            glm::vec4 motions_[MAX_EMITTERS];
+            glm::vec4 tints_[MAX_EMITTERS];
+
+            bool initialized_;
+            Geometry *quad_;
+            unsigned int step_;
+
+            // Particle state, read from buffers_[current_] and written to the other
+            GLuint buffers_[2];
+            GLuint update_vao_[2];
+            GLuint render_vao_[2];
+            int current_;
+
+            Shader update_shader_;
+            Uniform<float> delta_time_uniform_;
+            Uniform<float> seed_uniform_;
+            Uniform<int> update_slots_uniform_;
+            Uniform<glm::vec4> transform_uniform_;
+            Uniform<glm::vec4> spawn_uniform_;
+            Uniform<glm::vec4> motion_uniform_;
+
+            Shader render_shader_;
+            Uniform<glm::vec4> tint_uniform_;
+
+            // Compute backend: records, free list, draw command and live list
+            GLuint particle_ssbo_;
+            GLuint free_list_ssbo_;
+            GLuint draw_ssbo_;
+            GLuint alive_ssbo_;
+            GLuint compute_vao_;
+
+            Shader emit_shader_;
+            Uniform<float> emit_seed_uniform_;
+            Uniform<int> spawn_total_uniform_;
+            Uniform<glm::vec4> emit_transform_uniform_;
+            Uniform<glm::vec4> emit_spawn_uniform_;
+
+            Shader simulate_shader_;
+            Uniform<float> simulate_delta_time_uniform_;
+            Uniform<int> capacity_uniform_;
+            Uniform<glm::vec4> simulate_motion_uniform_;
+
+            Shader compute_render_shader_;
+            Uniform<glm::vec4> compute_tint_uniform_;
+
+    }; // class GpuParticleEngine
+
+} // namespace game
+
+#endif // GPU_PARTICLES_H_
@@ -0,0 +1,180 @@
+#include <iostream>
+#include <cstring>
+
+#include "input.h"
+
+namespace game {
+
+// GLFW key for each InputKey bit, in bit order
+static const int input_keys_g[] = {
+    GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_TAB, GLFW_KEY_D, GLFW_KEY_A, GLFW_KEY_Z,
+    GLFW_KEY_C, GLFW_KEY_ESCAPE, GLFW_KEY_Q, GLFW_KEY_E, GLFW_KEY_R, GLFW_KEY_F
+};
+
+// Identifies an input log
+static const char input_log_magic_g[4] = { 'F', 'P', 'I', 'N' };
+
+// Byte offset of the tick count in the header
+static const std::streamoff input_log_ticks_offset_g = 16;
+
+
+uint16_t PollKeyboard(GLFWwindow *window)
+{
+    uint16_t keys = 0;
+    for (int i = 0; i < sizeof(input_keys_g) / sizeof(int); i++) {
+        if (glfwGetKey(window, input_keys_g[i]) == GLFW_PRESS) {
+            keys |= (1 << i);
+        }
+    }
+    return keys;
+}
+
+
+InputRecorder::InputRecorder(void)
+{
+    writer_ = nullptr;
+    run_length_ = 0;
+    ticks_ = 0;
+}
+
+
+InputRecorder::~InputRecorder()
+{
+    // Don't lose the recording if the game is closed without Close()
+    try {
+        Close();
+    }
+    catch (std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+
+void InputRecorder::Open(const std::string &path, uint64_t seed)
+{
+    Close();
+
+    writer_ = new BinaryWriter(path);
+    writer_->Write(input_log_magic_g);
+    writer_->Write<uint16_t>(INPUT_LOG_VERSION);
+    writer_->Write<uint16_t>(0);
+    writer_->Write<uint64_t>(seed);
+    writer_->Write<uint32_t>(0); // Patched with the real count in Close()
+
+    run_length_ = 0;
+    ticks_ = 0;
+}
+
+
+void InputRecorder::Record(const InputFrame &frame)
+{
+    if (!writer_) {
+        return;
+    }
+
+    // Extend the current run if nothing changed
+    if (run_length_ > 0 && run_length_ < UINT16_MAX &&
+        frame.delta_time == run_frame_.delta_time && frame.keys == run_frame_.keys) {
+        run_length_++;
+    }
+    else {
+        WriteRun();
+        run_frame_ = frame;
+        run_length_ = 1;
+    }
+    ticks_++;
+}
+
+
+void InputRecorder::WriteRun(void)
+{
+    if (run_length_ == 0) {
+        return;
+    }
+    writer_->Write<double>(run_frame_.delta_time);
+    writer_->Write<uint16_t>(run_frame_.keys);
+    writer_->Write<uint16_t>(run_length_);
+}
+
+
+void InputRecorder::Close(void)
+{
+    if (!writer_) {
+        return;
+    }
+
+    WriteRun();
+    writer_->Seek(input_log_ticks_offset_g);
+    writer_->Write<uint32_t>(ticks_);
+
+    BinaryWriter *writer = writer_;
+    writer_ = nullptr;
+    run_length_ = 0;
+    writer->Close();
+    delete writer;
+
+    std::cout << "Recorded " << ticks_ << " ticks of input" << std::endl;
+}
+
+
+InputPlayback::InputPlayback(void)
+{
+    open_ = false;
+    seed_ = 0;
+    ticks_ = 0;
+    run_ = 0;
+    run_position_ = 0;
+}
+
+
+void InputPlayback::Open(const std::string &path)
+{
+    BinaryReader reader(path);
+
+    char magic[4];
+    for (int i = 0; i < 4; i++) {
+        magic[i] = reader.Read<char>();
+    }
+    if (memcmp(magic, input_log_magic_g, 4) != 0) {
+        throw(std::ios_base::failure(path + std::string(" is not an input log")));
+    }
+    uint16_t version = reader.Read<uint16_t>();
+    if (version != INPUT_LOG_VERSION) {
+        throw(std::ios_base::failure(path + std::string(" has unsupported input log version ") + std::to_string(version)));
+    }
+    reader.Read<uint16_t>();
+    seed_ = reader.Read<uint64_t>();
+    ticks_ = reader.Read<uint32_t>();
+
+    // The whole log is loaded up front so playback never touches the disk
+    runs_.clear();
+    while (!reader.AtEnd()) {
+        Run run;
+        run.frame.delta_time = reader.Read<double>();
+        run.frame.keys = reader.Read<uint16_t>();
+        run.length = reader.Read<uint16_t>();
+        runs_.push_back(run);
+    }
+
+    run_ = 0;
+    run_position_ = 0;
+    open_ = true;
+}
+
+
+bool InputPlayback::Next(InputFrame &frame)
+{
+    if (!open_ || run_ >= runs_.size()) {
+        return false;
+    }
+
+    frame = runs_[run_].frame;
+    run_position_++;
+    if (run_position_ >= runs_[run_].length) {
+        run_++;
+        run_position_ = 0;
+    }
+    return true;
+}
+
+} // namespace game
@@ -0,0 +1,109 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "binary_io.h"
+
+namespace game {
+
+    // One bit per key the game reacts to
+    enum InputKey {
+        INPUT_W             = 1 << 0,
+        INPUT_S             = 1 << 1,
+        INPUT_MENU          = 1 << 2,   // TAB
+        INPUT_RIGHT         = 1 << 3,   // D
+        INPUT_LEFT          = 1 << 4,   // A
+        INPUT_NUDGE_LEFT    = 1 << 5,   // Z
+        INPUT_NUDGE_RIGHT   = 1 << 6,   // C
+        INPUT_QUIT          = 1 << 7,   // ESC
+        INPUT_TURN_LEFT     = 1 << 8,   // Q
+        INPUT_TURN_RIGHT    = 1 << 9,   // E
+        INPUT_SWITCH_WEAPON = 1 << 10,  // R
+        INPUT_FIRE          = 1 << 11   // F
+    };
+
+    // Everything the simulation needs from the outside for one tick
+    struct InputFrame {
+        double delta_time;
+        uint16_t keys;
+    };
+
+    // Read the keyboard into a mask of InputKey bits
+    uint16_t PollKeyboard(GLFWwindow *window);
+
+
+    // Input logs are a header followed by runs of identical ticks:
+    //   "FPIN", version (uint16), reserved (uint16), run seed (uint64), tick count (uint32)
+    //   then per run: delta time (double), keys (uint16), repeat count (uint16)
+    // Runs keep the log small when the time step is fixed or the keys are held
+#define INPUT_LOG_VERSION 1
+
+    // Writes every tick's input to a log as the game is played
+    class InputRecorder {
+
+        public:
+            InputRecorder(void);
+            ~InputRecorder();
+
+            // Start a new log for a run with the given seed
+            void Open(const std::string &path, uint64_t seed);
+
+            // Append the input of one tick
+            void Record(const InputFrame &frame);
+
+            // Write the remaining data and the final tick count
+            void Close(void);
+
+            inline bool IsOpen(void) { return writer_ != nullptr; }
+
+        private:
+            void WriteRun(void);
+
+            BinaryWriter *writer_;
+            InputFrame run_frame_;
+            uint16_t run_length_;
+            uint32_t ticks_;
+
+    }; // class InputRecorder
+
+
+    // Feeds a recorded log back to the game one tick at a time
+    class InputPlayback {
+
+        public:
+            InputPlayback(void);
+
+            // Load a whole log, throws if it isn't a valid input log
+            void Open(const std::string &path);
+
+            // Get the next tick's input, returns false once the log is over
+            bool Next(InputFrame &frame);
+
+            inline bool IsOpen(void) { return open_; }
+            inline uint64_t GetSeed(void) { return seed_; }
+            inline uint32_t GetTickCount(void) { return ticks_; }
+
+        private:
+            struct Run {
+                InputFrame frame;
+                uint16_t length;
+            };
+
+            bool open_;
+            uint64_t seed_;
+            uint32_t ticks_;
+            std::vector<Run> runs_;
+            size_t run_;
+            uint16_t run_position_;
+
+    }; // class InputPlayback
+
+} // namespace game
+
+#endif // INPUT_H_
@@ -8,27 +8,184 @@
 
 #include <iostream>
 #include <exception>
+#include <stdexcept>
+#include <string>
+#include <cstdlib>
+#include "rng.h"
 #include "game.h"
 
 // Macro for printing exceptions
 #define PrintException(exception_object)\
     std::cerr << exception_object.what() << std::endl
 
+// Options that can be given on the command line
+struct Options {
+    bool headless = false;        // --headless: simulate without a window
+    int ticks = 3600;             // --ticks N: number of headless ticks
+    double delta_time = 1.0 / 60.0; // --dt SECONDS: length of a headless tick
+    bool has_seed = false;        // --seed N: run seed (random if not given)
+    uint64_t seed = 0;
+    std::string record_path;      // --record FILE: write an input log
+    std::string replay_path;      // --replay FILE: play back an input log
+    std::string load_path;        // --load-snapshot FILE: start from a saved world
+    std::string save_path;        // --save-snapshot FILE: save the world when the run ends
+    game::PacingMode pacing = game::PACING_VSYNC; // --vsync, --fps N or --uncapped
+    double fps = 60.0;
+    game::ParticleBackend particles = game::PARTICLES_FEEDBACK; // --gpu-particles feedback|compute
+    game::ParticleLayout particle_layout = game::PARTICLES_PROCEDURAL; // --particle-vertices buffers|procedural|instanced
+    int particle_divisor = 1;     // --particle-resolution full|half|quarter
+};
+
+// Read the options, throwing on anything that is not understood
+static Options ParseOptions(int argc, char *argv[]){
+    Options options;
+
+    for (int i = 1; i < argc; i++){
+        std::string arg = argv[i];
+        bool has_value = (i + 1 < argc);
+
+        if (arg == "--headless"){
+            options.headless = true;
+        }
+        else if (arg == "--ticks" && has_value){
+            options.ticks = std::atoi(argv[++i]);
+        }
+        else if (arg == "--dt" && has_value){
+            options.delta_time = std::atof(argv[++i]);
+        }
+        else if (arg == "--seed" && has_value){
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+            options.has_seed = true;
+        }
+        else if (arg == "--record" && has_value){
+            options.record_path = argv[++i];
+        }
+        else if (arg == "--replay" && has_value){
+            options.replay_path = argv[++i];
+        }
+        else if (arg == "--load-snapshot" && has_value){
+            options.load_path = argv[++i];
+        }
+        else if (arg == "--save-snapshot" && has_value){
+            options.save_path = argv[++i];
+        }
+        else if (arg == "--vsync"){
+            options.pacing = game::PACING_VSYNC;
+        }
+        else if (arg == "--fps" && has_value){
+            options.pacing = game::PACING_CAP;
+            options.fps = std::atof(argv[++i]);
+        }
+        else if (arg == "--uncapped"){
+            options.pacing = game::PACING_UNCAPPED;
+        }
+        else if (arg == "--gpu-particles" && has_value && std::string(argv[i + 1]) == "feedback"){
+            options.particles = game::PARTICLES_FEEDBACK;
+            i++;
+        }
+        else if (arg == "--gpu-particles" && has_value && std::string(argv[i + 1]) == "compute"){
+            options.particles = game::PARTICLES_COMPUTE;
+            i++;
+        }
+        else if (arg == "--particle-vertices" && has_value && std::string(argv[i + 1]) == "buffers"){
+            options.particle_layout = game::PARTICLES_BUFFERS;
+            i++;
+        }
+        else if (arg == "--particle-vertices" && has_value && std::string(argv[i + 1]) == "procedural"){
+            options.particle_layout = game::PARTICLES_PROCEDURAL;
+            i++;
+        }
+        else if (arg == "--particle-vertices" && has_value && std::string(argv[i + 1]) == "instanced"){
+            options.particle_layout = game::PARTICLES_INSTANCED;
+            i++;
+        }
+        else if (arg == "--particle-resolution" && has_value && std::string(argv[i + 1]) == "full"){
+            options.particle_divisor = 1;
+            i++;
+        }
+        else if (arg == "--particle-resolution" && has_value && std::string(argv[i + 1]) == "half"){
+            options.particle_divisor = 2;
+            i++;
+        }
+        else if (arg == "--particle-resolution" && has_value && std::string(argv[i + 1]) == "quarter"){
+            options.particle_divisor = 4;
+            i++;
+        }
+        else {
+            throw(std::invalid_argument(std::string("Unknown or incomplete option: ") + arg +
+                "\nUsage: FinalProject [--headless] [--ticks N] [--dt SECONDS] [--seed N] [--record FILE] [--replay FILE]"
+                " [--load-snapshot FILE] [--save-snapshot FILE] [--vsync | --fps N | --uncapped]"
+                " [--gpu-particles feedback|compute] [--particle-vertices buffers|procedural|instanced]"
+                " [--particle-resolution full|half|quarter]"));
+        }
+    }
+
+    if (options.ticks <= 0 || options.delta_time <= 0.0){
+        throw(std::invalid_argument(std::string("--ticks and --dt must be positive")));
+    }
+    if (options.fps <= 0.0){
+        throw(std::invalid_argument(std::string("--fps must be positive")));
+    }
+
+    return options;
+}
+
 // Main function that builds and runs the game
-int main(void){
+int main(int argc, char *argv[]){
     game::Game the_game;
 
     try {
+        Options options = ParseOptions(argc, argv);
+
+        // Pick the run seed once; every system's random stream is derived from it
+        // A replay always uses the seed it was recorded with
+        if (!options.replay_path.empty()){
+            the_game.StartReplay(options.replay_path);
+        }
+        else {
+            game::SetRunSeed(options.has_seed ? options.seed : game::MakeRandomSeed());
+        }
+        std::cout << "Run seed: " << game::GetRunSeed() << std::endl;
+
+        if (!options.record_path.empty()){
+            the_game.StartRecording(options.record_path);
+        }
+
+        if (options.headless){
+            // Simulate only, then report performance
+            the_game.InitHeadless();
+            the_game.Setup();
+            if (!options.load_path.empty()){
+                the_game.LoadSnapshot(options.load_path);
+            }
+            the_game.RunHeadless(options.ticks, options.delta_time);
+            if (!options.save_path.empty()){
+                the_game.SaveSnapshot(options.save_path);
+            }
+            return 0;
+        }
+
         // Initialize graphics libraries and main window
+        the_game.SetFramePacing(options.pacing, options.fps);
+        the_game.SetParticleBackend(options.particles);
+        the_game.SetParticleLayout(options.particle_layout);
+        the_game.SetParticleResolution(options.particle_divisor);
         the_game.Init();
         // Setup the game (scene, game objects, etc.)
         the_game.Setup();
+        if (!options.load_path.empty()){
+            the_game.LoadSnapshot(options.load_path);
+        }
         // Run the game
         the_game.MainLoop();
+        if (!options.save_path.empty()){
+            the_game.SaveSnapshot(options.save_path);
+        }
     }
     catch (std::exception &e){
         // Catch and print any errors
         PrintException(e);
+        return 1;
     }
 
     return 0;
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <iostream>
+
+#include "particle_budget.h"
+
+namespace game {
+
+// Systems at least this fraction of the view's height across get full detail
+static const float full_detail_size_g = 0.25f;
+
+// No system drops below this level of detail, so it never vanishes
+static const float min_detail_g = 0.05f;
+
+// Systems at the edge of the view keep this much of their detail
+static const float edge_detail_g = 0.5f;
+
+// How much of the way to the new load is covered each frame
+static const float load_smoothing_g = 0.2f;
+
+
+ParticleBudget::ParticleBudget(int budget)
+{
+    budget_ = budget;
+    visible_.min = glm::vec2(-1.0f, -1.0f);
+    visible_.max = glm::vec2(1.0f, 1.0f);
+    load_scale_ = 1.0f;
+    demand_ = 0.0;
+    granted_ = 0;
+    live_count_ = 0;
+    frames_ = 0;
+    total_granted_ = 0.0;
+    total_load_scale_ = 0.0;
+}
+
+
+void ParticleBudget::Begin(const Rect &visible)
+{
+    visible_ = visible;
+}
+
+
+float ParticleBudget::Allocate(const glm::vec2 &center, float radius, int full_count)
+{
+    glm::vec2 half_size = 0.5f * (visible_.max - visible_.min);
+    glm::vec2 middle = 0.5f * (visible_.max + visible_.min);
+
+    // Size on screen, relative to the view's height
+    float size = 2.0f * radius / std::max(2.0f * half_size.y, 0.0001f);
+    float size_detail = std::min(size / full_detail_size_g, 1.0f);
+
+    // Distance from the middle of the view, 1 at the corners
+    float distance = glm::length(center - middle) / std::max(glm::length(half_size), 0.0001f);
+    float distance_detail = 1.0f - (1.0f - edge_detail_g) * std::min(distance, 1.0f);
+
+    float detail = size_detail * distance_detail;
+    demand_ += detail * full_count;
+
+    detail = std::max(detail * load_scale_, min_detail_g);
+    granted_ += (int)(detail * full_count);
+    return detail;
+}
+
+
+void ParticleBudget::End(void)
+{
+    // The share that would have fit this frame's demand in the budget
+    float target = 1.0f;
+    if (demand_ > budget_) {
+        target = (float)(budget_ / demand_);
+    }
+    load_scale_ += (target - load_scale_) * load_smoothing_g;
+
+    live_count_ = granted_;
+    frames_++;
+    total_granted_ += granted_;
+    total_load_scale_ += load_scale_;
+
+    demand_ = 0.0;
+    granted_ = 0;
+}
+
+
+void ParticleBudget::Report(void)
+{
+    if (frames_ == 0) {
+        return;
+    }
+    std::cout << "Particle budget: " << total_granted_ / frames_ << " particles per frame (budget "
+        << budget_ << "), average load scale " << total_load_scale_ / frames_ << std::endl;
+}
+
+} // namespace game
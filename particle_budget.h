@@ -0,0 +1,67 @@
+#ifndef PARTICLE_BUDGET_H_
+#define PARTICLE_BUDGET_H_
+
+#include <glm/glm.hpp>
+
+#include "culling.h"
+
+namespace game {
+
+    // Shares a number of particles a frame between the particle systems in
+    // view, so heavy fights cost about as much fill rate as the budget and
+    // no more. Each system asks for its full count and gets a level of
+    // detail (the fraction of it to draw or spawn) from:
+    //   - how big it looks: small systems need fewer particles
+    //   - how far it is from the middle of the view
+    //   - the load: when everything asked for is over the budget, every
+    //     system gets the same smaller share
+    // The load follows the demand of the last frames smoothly, so detail
+    // fades out and back in over a few frames instead of jumping
+    class ParticleBudget {
+
+        public:
+            // budget is the number of particles to aim for in a frame
+            ParticleBudget(int budget = 15000);
+
+            // Start a frame with the area in view
+            void Begin(const Rect &visible);
+
+            // Level of detail in (0, 1] for a system with the given bounds
+            // and full particle count; also counts the particles granted
+            // Requests made between frames (e.g. explosion bursts during the
+            // update) count towards the next frame
+            float Allocate(const glm::vec2 &center, float radius, int full_count);
+
+            // End the frame: update the load from what was asked for
+            void End(void);
+
+            // Particles granted in the last frame: those drawn by particle
+            // geometry plus the particles GPU emitters keep alive
+            inline int GetLiveCount(void) const { return live_count_; }
+            inline float GetLoadScale(void) const { return load_scale_; }
+
+            // Print the average particles granted and load per frame
+            void Report(void);
+
+        private:
+            int budget_;
+            Rect visible_;
+
+            // Fraction of every request granted because of the load
+            float load_scale_;
+
+            // This frame's requests (after size and distance) and grants
+            double demand_;
+            int granted_;
+            int live_count_;
+
+            // For Report()
+            int frames_;
+            double total_granted_;
+            double total_load_scale_;
+
+    }; // class ParticleBudget
+
+} // namespace game
+
+#endif // PARTICLE_BUDGET_H_
@@ -0,0 +1,13 @@
+// Source code of fragment shader for adding the particle framebuffer to the window
+#version 130
+
+// Attributes passed from the vertex shader
+in vec2 uv_interp;
+
+// The particles at reduced resolution, filtered (bilinear) when sampled
+uniform sampler2D onetex;
+
+void main()
+{
+    gl_FragColor = texture2D(onetex, uv_interp);
+}
@@ -0,0 +1,14 @@
+// Source code of vertex shader for adding the particle framebuffer to the window
+// One triangle covering the screen, no vertex buffer
+#version 130
+
+// Attributes forwarded to the fragment shader
+out vec2 uv_interp;
+
+void main()
+{
+    // Corners (-1, -1), (3, -1) and (-1, 3): the screen and some to spare
+    vec2 corner = vec2(float((gl_VertexID & 1) << 2) - 1.0, float((gl_VertexID & 2) << 1) - 1.0);
+    gl_Position = vec4(corner, 0.0, 1.0);
+    uv_interp = corner*0.5 + 0.5;
+}
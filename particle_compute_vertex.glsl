@@ -0,0 +1,49 @@
+// Source code of vertex shader for particles simulated by compute shaders
+// One instance of the unit quad per live particle
+#version 430
+
+// Must match MAX_EMITTERS in gpu_particles.h
+#define MAX_EMITTERS 64
+
+// Vertex buffer (the shared unit quad)
+in vec2 vertex;
+in vec2 uv;
+
+// Particle records and the live ones (see particle_simulate.glsl)
+struct Particle {
+    vec4 motion; // Position (xy), velocity (zw)
+    vec4 age;    // Age (x), lifetime (y), emitter (z)
+};
+layout(std430, binding = 0) readonly buffer Particles {
+    Particle particles[];
+};
+layout(std430, binding = 3) readonly buffer AliveList {
+    uint alive_indices[];
+};
+
+// Per-frame values shared by all programs (see FrameData)
+layout(std140) uniform Frame {
+    mat4 view_matrix;
+    vec4 camera; // Position (xy), zoom (z), time (w)
+};
+
+// Uniform (global) buffer
+uniform vec4 emitter_tint[MAX_EMITTERS]; // Colour (rgb), size (a)
+
+// Attributes forwarded to the fragment shader
+out vec4 color_interp;
+out vec2 uv_interp;
+
+void main()
+{
+    Particle p = particles[alive_indices[gl_InstanceID]];
+    vec4 tint = emitter_tint[int(p.age.z)];
+
+    vec2 world_pos = p.motion.xy + vertex*tint.a;
+    gl_Position = view_matrix*vec4(world_pos, 0.0, 1.0);
+
+    // Fade out over the lifetime
+    float fade = 1.0 - p.age.x/max(p.age.y, 0.0001);
+    color_interp = vec4(tint.rgb*fade, 1.0);
+    uv_interp = uv;
+}
@@ -0,0 +1,65 @@
+// Source code of the particle emit compute shader
+// One invocation per particle spawned this step
+#version 430
+
+layout(local_size_x = 256) in;
+
+// Must match MAX_EMITTERS in gpu_particles.h
+#define MAX_EMITTERS 64
+
+// Particle records and the stack of free record indices (see GpuParticleEngine)
+struct Particle {
+    vec4 motion; // Position (xy), velocity (zw)
+    vec4 age;    // Age (x), lifetime (y), emitter (z); free once age >= lifetime
+};
+layout(std430, binding = 0) buffer Particles {
+    Particle particles[];
+};
+layout(std430, binding = 1) buffer FreeList {
+    int free_count;
+    uint free_indices[];
+};
+
+// Uniform (global) buffer
+uniform float seed; // Changes every step
+uniform int spawn_total;
+uniform vec4 emitter_transform[MAX_EMITTERS]; // Position (xy), angle (z), spread (w)
+uniform vec4 emitter_spawn[MAX_EMITTERS];     // First invocation (x), count (y), speed (z), lifetime (w)
+
+// Pseudo-random number in [0, 1) for an invocation
+float random(float id, float salt)
+{
+    return fract(sin(dot(vec3(id, seed, salt), vec3(12.9898, 78.233, 37.719))) * 43758.5453);
+}
+
+void main()
+{
+    int id = int(gl_GlobalInvocationID.x);
+    if (id >= spawn_total) {
+        return;
+    }
+
+    // Emitters' invocations follow each other in emitter order
+    int emitter = 0;
+    while (emitter < MAX_EMITTERS - 1 && id >= int(emitter_spawn[emitter].x + emitter_spawn[emitter].y)) {
+        emitter++;
+    }
+    vec4 transform = emitter_transform[emitter];
+    vec4 spawn = emitter_spawn[emitter];
+
+    // Take a free record; when there is none the particle is dropped
+    int top = atomicAdd(free_count, -1) - 1;
+    if (top < 0) {
+        atomicAdd(free_count, 1);
+        return;
+    }
+    uint index = free_indices[top];
+
+    // Emitters face -y turned by their angle (behind their parent)
+    float angle = transform.z + (2.0*random(float(id), 1.0) - 1.0)*transform.w;
+    float speed = spawn.z*(0.5 + 0.5*random(float(id), 2.0));
+    vec2 dir = vec2(sin(angle), -cos(angle));
+
+    particles[index].motion = vec4(transform.xy, dir*speed);
+    particles[index].age = vec4(0.0, spawn.w*(0.5 + 0.5*random(float(id), 3.0)), float(emitter), 0.0);
+}
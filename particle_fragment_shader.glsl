@@ -12,7 +12,7 @@ void main()
 {
     // Sample texture
     vec4 color = texture2D(onetex, uv_interp);
-    color.rgb = vec3(0.8, 0.4, 0.01) * color_interp.r;
+    color.rgb = color_interp.rgb;
 
     // Assign color to fragment
     gl_FragColor = vec4(color.r, color.g, color.b, color.a);
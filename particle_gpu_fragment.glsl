@@ -1,4 +1,4 @@
-// Source code of fragment shader
+// Source code of fragment shader for simulated particles
 #version 130
 
 // Attributes passed from the vertex shader
@@ -10,9 +10,9 @@ uniform sampler2D onetex;
 
 void main()
 {
-    // Sample texture
+    // Sample texture, coloured by the emitter
     vec4 color = texture2D(onetex, uv_interp);
-    color.rgb = vec3(0.1, 1.0, 0.01) * color_interp.r;
+    color.rgb = color_interp.rgb;
 
     // Assign color to fragment
     gl_FragColor = vec4(color.r, color.g, color.b, color.a);
@@ -0,0 +1,43 @@
+// Source code of vertex shader for simulated particles
+// One instance of the unit quad per particle slot
+#version 130
+#extension GL_ARB_uniform_buffer_object : require
+
+// Must match MAX_EMITTERS in gpu_particles.h
+#define MAX_EMITTERS 64
+
+// Vertex buffer (the shared unit quad)
+in vec2 vertex;
+in vec2 uv;
+
+// Instance buffer (the particle records, see particle_update.glsl)
+in vec4 particle;     // Position (xy), velocity (zw)
+in vec3 particle_age; // Age (x), lifetime (y), emitter (z)
+
+// Per-frame values shared by all programs (see FrameData)
+layout(std140) uniform Frame {
+    mat4 view_matrix;
+    vec4 camera; // Position (xy), zoom (z), time (w)
+};
+
+// Uniform (global) buffer
+uniform vec4 emitter_tint[MAX_EMITTERS]; // Colour (rgb), size (a)
+
+// Attributes forwarded to the fragment shader
+out vec4 color_interp;
+out vec2 uv_interp;
+
+void main()
+{
+    vec4 tint = emitter_tint[int(particle_age.z)];
+
+    // Free slots collapse to a point, which covers no pixels
+    float alive = (particle_age.x < particle_age.y) ? 1.0 : 0.0;
+    vec2 world_pos = particle.xy + vertex*tint.a*alive;
+    gl_Position = view_matrix*vec4(world_pos, 0.0, 1.0);
+
+    // Fade out over the lifetime
+    float fade = 1.0 - particle_age.x/max(particle_age.y, 0.0001);
+    color_interp = vec4(tint.rgb*fade, 1.0);
+    uv_interp = uv;
+}
@@ -0,0 +1,68 @@
+// Source code of the particle simulate compute shader
+// One invocation per particle record
+#version 430
+
+layout(local_size_x = 256) in;
+
+// Must match MAX_EMITTERS in gpu_particles.h
+#define MAX_EMITTERS 64
+
+// Particle records, the stack of free record indices, the draw command
+// and the list of live records it draws (see GpuParticleEngine)
+struct Particle {
+    vec4 motion; // Position (xy), velocity (zw)
+    vec4 age;    // Age (x), lifetime (y), emitter (z); free once age >= lifetime
+};
+layout(std430, binding = 0) buffer Particles {
+    Particle particles[];
+};
+layout(std430, binding = 1) buffer FreeList {
+    int free_count;
+    uint free_indices[];
+};
+layout(std430, binding = 2) buffer DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int base_vertex;
+    uint base_instance;
+};
+layout(std430, binding = 3) buffer AliveList {
+    uint alive_indices[];
+};
+
+// Uniform (global) buffer
+uniform float delta_time;
+uniform int capacity;
+uniform vec4 emitter_motion[MAX_EMITTERS]; // Gravity (x), drag (y), emitter movement to follow (zw)
+
+void main()
+{
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= uint(capacity)) {
+        return;
+    }
+
+    // Free records are already on the free list
+    Particle p = particles[id];
+    if (p.age.x >= p.age.y) {
+        return;
+    }
+
+    // Drag, gravity, then move (partly along with the emitter)
+    vec4 motion = emitter_motion[int(p.age.z)];
+    vec2 velocity = p.motion.zw*max(1.0 - motion.y*delta_time, 0.0) - vec2(0.0, motion.x*delta_time);
+    p.motion = vec4(p.motion.xy + velocity*delta_time + motion.zw, velocity);
+    p.age.x += delta_time;
+    particles[id] = p;
+
+    // Dying records go back on the free list, live ones are listed for drawing
+    if (p.age.x >= p.age.y) {
+        int slot = atomicAdd(free_count, 1);
+        free_indices[slot] = id;
+    }
+    else {
+        uint slot = atomicAdd(instance_count, 1u);
+        alive_indices[slot] = id;
+    }
+}
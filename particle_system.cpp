@@ -1,14 +1,21 @@
-#define GLM_FORCE_RADIANS
-#include <glm/gtc/matrix_transform.hpp>
-
 #include "particle_system.h"
+#include "particles.h"
 
 namespace game {
 
-ParticleSystem::ParticleSystem(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, GameObject *parent)
+ParticleSystem::ParticleSystem(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, GameObject *parent, const ParticleStyle &style)
 	: GameObject(position, geom, shader, texture){
 
     parent_ = parent;
+    style_ = style;
+    engine_ = nullptr;
+    emitter_ = -1;
+}
+
+
+ParticleSystem::~ParticleSystem(){
+
+    ReleaseEmitter();
 }
 
 
@@ -20,48 +27,106 @@ void ParticleSystem::Update(double delta_time) {
     if (parent_->CheckDead()) {
         isDead_ = true;
     }
+
+    // Particles already emitted live on after the system is gone
+    if (engine_) {
+        if (isDead_) {
+            ReleaseEmitter();
+        }
+        else {
+            UpdateEmitter();
+        }
+    }
+}
+
+
+void ParticleSystem::AttachEmitter(GpuParticleEngine *engine, int emitter){
+
+    engine_ = engine;
+    emitter_ = emitter;
+    UpdateEmitter();
+}
+
+
+void ParticleSystem::ReleaseEmitter(void){
+
+    if (engine_) {
+        engine_->ReleaseEmitter(emitter_);
+        engine_ = nullptr;
+        emitter_ = -1;
+    }
 }
 
 
-void ParticleSystem::Render(glm::mat4 view_matrix, double current_time){
+void ParticleSystem::UpdateEmitter(void){
+
+    // Same placement as the geometry gets in the particle vertex shaders
+    float parent_angle = parent_->GetAngle();
+    float c = cos(parent_angle);
+    float s = sin(parent_angle);
+    glm::vec2 offset(c * position_.x - s * position_.y, s * position_.x + c * position_.y);
+    glm::vec2 world_pos = glm::vec2(parent_->GetPosition().x, parent_->GetPosition().y) + offset;
+    engine_->SetEmitterTransform(emitter_, world_pos, parent_angle + angle_);
+}
+
 
-    // Set up the shader
-    shader_->Enable();
+void ParticleSystem::Restart(const glm::vec3 &position, Geometry *geom, GameObject *parent){
 
-    // Set up the view matrix
-    shader_->SetUniformMat4("view_matrix", view_matrix);
+    // Same state the constructor sets up; the shader, texture and style stay
+    ReleaseEmitter();
+    position_ = position;
+    scale_ = 1.0f;
+    angle_ = 0.0f;
+    velocity_ = glm::vec3(0.0f, 0.0f, 0.0f);
+    geometry_ = geom;
+    parent_ = parent;
+    isChild_ = false;
+    isDead_ = false;
+    mustDie_ = false;
+    current_time_ = SimClock::now();
+    death_time_ = current_time_ + std::chrono::seconds(100);
+}
 
-    // Setup the scaling matrix for the shader
-    glm::mat4 scaling_matrix = glm::scale(glm::mat4(1.0f), glm::vec3(scale_, scale_, 1.0));
 
-    // Setup the rotation matrix for the shader
-    glm::mat4 rotation_matrix = glm::rotate(glm::mat4(1.0f), angle_, glm::vec3(0.0, 0.0, 1.0));
+void ParticleSystem::GetBounds(glm::vec2 &center, float &radius){
 
-    // Set up the translation matrix for the shader
-    glm::mat4 translation_matrix = glm::translate(glm::mat4(1.0f), position_);
+    // Particles fly at most cycle * speed * |dir| (0.8) from the system's
+    // origin in the particle shader, plus what gravity adds, plus half a quad
+    float particle_reach = style_.cycle * style_.speed * 0.8f +
+        0.5f * fabs(style_.gravity) * style_.cycle * style_.cycle + 0.7072f;
 
-    // Set up the parent transformation matrix
-    glm::mat4 parent_rotation_matrix = glm::rotate(glm::mat4(1.0f), parent_->GetAngle(), glm::vec3(0.0, 0.0, 1.0));
-    glm::mat4 parent_translation_matrix = glm::translate(glm::mat4(1.0f), parent_->GetPosition());
-    glm::mat4 parent_transformation_matrix = parent_translation_matrix * parent_rotation_matrix;
+    center = glm::vec2(parent_->GetPosition().x, parent_->GetPosition().y);
+    radius = glm::length(position_) + particle_reach * scale_;
+}
 
-    // Setup the transformation matrix for the shader
-    glm::mat4 transformation_matrix = parent_transformation_matrix * translation_matrix * rotation_matrix * scaling_matrix;
 
-    // Set the transformation matrix in the shader
-    shader_->SetUniformMat4("transformation_matrix", transformation_matrix);
+void ParticleSystem::Render(RenderQueue &queue, double current_time){
 
-    // Set the time in the shader
-    shader_->SetUniform1f("time", current_time);
+    // Share of the particle budget, by size on screen, distance and load
+    float detail = 1.0f;
+    ParticleBudget *budget = queue.GetParticleBudget();
+    if (budget) {
+        glm::vec2 center;
+        float radius;
+        GetBounds(center, radius);
+        detail = budget->Allocate(center, radius, engine_ ? engine_->GetEmitterDemand(emitter_) : NUM_PARTICLE_QUADS);
+    }
 
-    // Set up the geometry
-    geometry_->SetGeometry(shader_->GetShaderProgram());
+    // The engine draws all of its particles at once, this only sets how
+    // many the emitter spawns
+    if (engine_) {
+        engine_->SetEmitterDetail(emitter_, detail);
+        return;
+    }
 
-    // Bind the particle texture
-    glBindTexture(GL_TEXTURE_2D, texture_);
+    // Only the position, angle and scale of the system and its parent are
+    // sent; the particle vertex shader builds the transformation from them
+    glm::vec4 transform(position_.x, position_.y, angle_, scale_);
+    glm::vec3 parent_transform(parent_->GetPosition().x, parent_->GetPosition().y, parent_->GetAngle());
+    glm::vec4 style(style_.cycle, style_.speed, style_.gravity, 0.0f);
 
-    // Draw the entity
-    glDrawElements(GL_TRIANGLES, geometry_->GetSize(), GL_UNSIGNED_INT, 0);
+    // The queue sets the shader, texture and uniforms when it draws
+    queue.AddParticles(shader_, geometry_, texture_, transform, parent_transform, style, style_.tint, detail);
 }
 
 } // namespace game
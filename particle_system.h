@@ -2,21 +2,59 @@
 #define PARTICLE_SYSTEM_H_
 
 #include "game_object.h"
+#include "gpu_particles.h"
 
 namespace game {
 
+    // How a system's particles move and look, sent to the particle vertex
+    // shader with each draw, so every kind of system shares one program
+    // The spread of the directions belongs to the geometry (see SetRange)
+    struct ParticleStyle {
+        float cycle;        // Seconds before a particle starts over
+        float speed;        // Distance a second along its direction
+        float gravity;      // Pull along the system's y axis (0 for none)
+        glm::vec3 tint;     // Colour, faded by each particle's phase
+    };
+
     // Inherits from GameObject
     class ParticleSystem : public GameObject {
 
         public:
-            ParticleSystem(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, GameObject *parent);
+            ParticleSystem(const glm::vec3 &position, Geometry *geom, Shader *shader, GLuint texture, GameObject *parent, const ParticleStyle &style);
+
+            // Releases the emitter, if the system still has one
+            ~ParticleSystem() override;
 
             void Update(double delta_time) override;
 
-            void Render(glm::mat4 view_matrix, double current_time);
+            // Start over as a new system following parent, keeping the
+            // shader, texture and style, so finished systems can be reused
+            void Restart(const glm::vec3 &position, Geometry *geom, GameObject *parent);
+
+            void Render(RenderQueue &queue, double current_time) override;
+
+            // Covers every particle at the end of its flight around the parent
+            void GetBounds(glm::vec2 &center, float &radius) override;
+
+            // Drive an emitter of the GPU particle engine instead of drawing
+            // the geometry; the emitter is released when the system dies or
+            // is deleted
+            void AttachEmitter(GpuParticleEngine *engine, int emitter);
+
+            // The particle system follows parent_ (inherited from GameObject)
+            // without being a child object, so isChild_ stays false
 
         private:
-            GameObject *parent_;
+            // Move the emitter to where the system is in the world
+            void UpdateEmitter(void);
+
+            // Give the emitter back to the engine, its particles fade out
+            void ReleaseEmitter(void);
+
+            ParticleStyle style_;
+
+            GpuParticleEngine *engine_;
+            int emitter_;
 
     }; // class ParticleSystem
 
@@ -0,0 +1,109 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "particle_target.h"
+#include "render_state.h"
+
+namespace game {
+
+ParticleTarget::ParticleTarget(void)
+{
+    divisor_ = 1;
+    window_width_ = 0;
+    window_height_ = 0;
+    width_ = 0;
+    height_ = 0;
+    framebuffer_ = 0;
+    color_texture_ = 0;
+    vao_ = 0;
+}
+
+
+ParticleTarget::~ParticleTarget()
+{
+    // Never initialized (full resolution, or no OpenGL context)
+    if (framebuffer_ == 0) {
+        return;
+    }
+
+    glDeleteFramebuffers(1, &framebuffer_);
+    glDeleteTextures(1, &color_texture_);
+    glDeleteVertexArrays(1, &vao_);
+}
+
+
+void ParticleTarget::Init(const std::string &shader_directory)
+{
+    if (divisor_ <= 1) {
+        return;
+    }
+
+    composite_shader_.Init((shader_directory + "/particle_composite_vertex.glsl").c_str(), (shader_directory + "/particle_composite_fragment.glsl").c_str());
+
+    glGenFramebuffers(1, &framebuffer_);
+    glGenTextures(1, &color_texture_);
+    glGenVertexArrays(1, &vao_);
+}
+
+
+void ParticleTarget::Resize(int window_width, int window_height)
+{
+    window_width_ = window_width;
+    window_height_ = window_height;
+    width_ = std::max(window_width / divisor_, 1);
+    height_ = std::max(window_height / divisor_, 1);
+
+    // Filtered when upsampled, clamped so the edges don't wrap around
+    glBindTexture(GL_TEXTURE_2D, color_texture_);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width_, height_, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture_, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        throw(std::runtime_error(std::string("Could not create the particle framebuffer")));
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+
+void ParticleTarget::Begin(int window_width, int window_height)
+{
+    if (framebuffer_ == 0) {
+        return;
+    }
+
+    if (window_width != window_width_ || window_height != window_height_) {
+        Resize(window_width, window_height);
+    }
+
+    // Nothing to add where no particle was drawn
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer_);
+    glViewport(0, 0, width_, height_);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+}
+
+
+void ParticleTarget::End(void)
+{
+    if (framebuffer_ == 0) {
+        return;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, window_width_, window_height_);
+
+    // Added like the particles themselves were (same pass state)
+    SetRenderPass(PASS_PARTICLES);
+    composite_shader_.Enable();
+    glBindTexture(GL_TEXTURE_2D, color_texture_);
+    glBindVertexArray(vao_);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+}
+
+} // namespace game
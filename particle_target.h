@@ -0,0 +1,55 @@
+#ifndef PARTICLE_TARGET_H_
+#define PARTICLE_TARGET_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <string>
+
+#include "shader.h"
+
+namespace game {
+
+    // Offscreen framebuffer the particles are drawn into at a fraction of
+    // the window's resolution, then added over the sprites with a bilinear
+    // upsample. Particles are additive quads without a depth test, so they
+    // are pure fill rate: half resolution is a quarter of the fragments
+    // The divisor is 1 (draw straight to the window), 2 (half) or 4 (quarter)
+    class ParticleTarget {
+
+        public:
+            ParticleTarget(void);
+            ~ParticleTarget();
+
+            // Choose the divisor; call before Init
+            inline void SetDivisor(int divisor) { divisor_ = divisor; }
+            inline int GetDivisor(void) const { return divisor_; }
+
+            // Create the framebuffer and the composite program (needs an
+            // OpenGL context); does nothing when the divisor is 1
+            void Init(const std::string &shader_directory);
+
+            // Start drawing particles for a window of the given size
+            // (the framebuffer follows its size), cleared to black
+            void Begin(int window_width, int window_height);
+
+            // Go back to the window and add the particles over it
+            void End(void);
+
+        private:
+            // (Re)create the colour texture for a window size
+            void Resize(int window_width, int window_height);
+
+            int divisor_;
+            int window_width_, window_height_;
+            int width_, height_;
+
+            GLuint framebuffer_;
+            GLuint color_texture_;
+            GLuint vao_;            // Empty, the triangle comes from gl_VertexID
+            Shader composite_shader_;
+
+    }; // class ParticleTarget
+
+} // namespace game
+
+#endif // PARTICLE_TARGET_H_
@@ -0,0 +1,65 @@
+// Source code of the particle update shader
+// Runs once per particle slot with transform feedback; no fragments
+#version 130
+
+// Must match MAX_EMITTERS in gpu_particles.h
+#define MAX_EMITTERS 64
+
+// Particle record (see GpuParticleEngine)
+in vec4 particle;     // Position (xy), velocity (zw)
+in vec3 particle_age; // Age (x), lifetime (y), emitter (z); free once age >= lifetime
+
+// Captured into the other buffer
+out vec4 next_particle;
+out vec3 next_particle_age;
+
+// Uniform (global) buffer
+uniform float delta_time;
+uniform float seed; // Changes every step
+uniform int slots_per_emitter;
+uniform vec4 emitter_transform[MAX_EMITTERS]; // Position (xy), angle (z), spread (w)
+uniform vec4 emitter_spawn[MAX_EMITTERS];     // First slot to spawn (x), count (y), speed (z), lifetime (w)
+uniform vec4 emitter_motion[MAX_EMITTERS];    // Gravity (x), drag (y), emitter movement to follow (zw)
+
+// Pseudo-random number in [0, 1) for a slot
+float random(float slot, float salt)
+{
+    return fract(sin(dot(vec3(slot, seed, salt), vec3(12.9898, 78.233, 37.719))) * 43758.5453);
+}
+
+void main()
+{
+    int emitter = gl_VertexID / slots_per_emitter;
+    int slot = gl_VertexID - emitter * slots_per_emitter;
+    vec4 transform = emitter_transform[emitter];
+    vec4 spawn = emitter_spawn[emitter];
+    vec4 motion = emitter_motion[emitter];
+
+    // This step's spawn window is a run of slots on a ring over the
+    // emitter's slots; anything in it starts over, oldest first
+    int window = (slot - int(spawn.x) + slots_per_emitter) % slots_per_emitter;
+    if (window < int(spawn.y)) {
+        float id = float(gl_VertexID);
+
+        // Emitters face -y turned by their angle (behind their parent)
+        float angle = transform.z + (2.0*random(id, 1.0) - 1.0)*transform.w;
+        float speed = spawn.z*(0.5 + 0.5*random(id, 2.0));
+        vec2 dir = vec2(sin(angle), -cos(angle));
+
+        next_particle = vec4(transform.xy, dir*speed);
+        next_particle_age = vec3(0.0, spawn.w*(0.5 + 0.5*random(id, 3.0)), float(emitter));
+        return;
+    }
+
+    // Free slots stay free
+    if (particle_age.x >= particle_age.y) {
+        next_particle = particle;
+        next_particle_age = particle_age;
+        return;
+    }
+
+    // Drag, gravity, then move (partly along with the emitter)
+    vec2 velocity = particle.zw*max(1.0 - motion.y*delta_time, 0.0) - vec2(0.0, motion.x*delta_time);
+    next_particle = vec4(particle.xy + velocity*delta_time + motion.zw, velocity);
+    next_particle_age = vec3(particle_age.x + delta_time, particle_age.yz);
+}
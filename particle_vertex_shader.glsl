@@ -1,51 +1,145 @@
-// Source code of vertex shader for particle system
+// Source code of vertex shader for particle systems
+// Every kind of system uses it, with its own entry in the Emitters block
 #version 130
+#extension GL_ARB_uniform_buffer_object : require
+#extension GL_ARB_draw_instanced : require
+
+// Must match MAX_BATCH_EMITTERS in emitter_uniforms.h
+#define MAX_BATCH_EMITTERS 128
 
 // Vertex buffer
 in vec2 vertex; // Vertex coordinates
 in vec2 dir; // Velocity
 in float t; // Phase
 in vec2 uv; // Texture coordinates
+in float size; // Quad size (per instance for instanced particles, else 1)
 
 // Uniform (global) buffer
-uniform mat4 transformation_matrix;
-uniform mat4 view_matrix;
-uniform float time; // Timer
+uniform int emitter_first;        // Entry of the Emitters block to draw
+uniform int emitter_per_instance; // 1 if each instance is the next entry (batched systems)
+
+// Values of the systems being drawn (see EmitterData)
+layout(std140) uniform Emitters {
+    vec4 emitter_transform[MAX_BATCH_EMITTERS];  // Position (xy), angle (z), scale (w) relative to the parent
+    vec4 emitter_parent[MAX_BATCH_EMITTERS];     // Parent's position (xy) and angle (z), particles to draw (w)
+    vec4 emitter_style[MAX_BATCH_EMITTERS];      // Cycle in seconds (x), speed (y), gravity (z), see ParticleStyle
+    vec4 emitter_tint[MAX_BATCH_EMITTERS];       // Colour (rgb), faded by the phase
+    vec4 emitter_procedural[MAX_BATCH_EMITTERS]; // Seed (x), direction range (y), explosion (z), on (w)
+};
+
+// This vertex's system, read once in main()
+vec4 transform;
+vec4 parent_transform;
+vec4 style;
+vec3 tint;
+vec4 procedural;
+
+// Per-frame values shared by all programs (see FrameData)
+layout(std140) uniform Frame {
+    mat4 view_matrix;
+    vec4 camera; // Position (xy), zoom (z), time (w)
+};
 
 // Attributes forwarded to the fragment shader
 out vec4 color_interp;
 out vec2 uv_interp;
 
+// Rotate a 2D vector counterclockwise by angle radians
+vec2 rotate(vec2 v, float angle)
+{
+    float c = cos(angle);
+    float s = sin(angle);
+    return mat2(c, s, -s, c) * v;
+}
+
+// Pseudo-random number in [0, 1) from an integer and the seed
+float random(uint n)
+{
+    n = n*747796405u + uint(procedural.x)*2891336453u;
+    n = ((n >> ((n >> 28u) + 4u)) ^ n)*277803737u;
+    n = (n >> 22u) ^ n;
+    return float(n >> 8u)/16777216.0;
+}
+
 void main()
 {
+    int emitter = emitter_first + emitter_per_instance*gl_InstanceIDARB;
+    transform = emitter_transform[emitter];
+    parent_transform = emitter_parent[emitter];
+    style = emitter_style[emitter];
+    tint = emitter_tint[emitter].rgb;
+    procedural = emitter_procedural[emitter];
+
+    // Vertex inputs, generated below for procedural geometry
+    vec2 v_pos = vertex*size;
+    vec2 v_dir = dir;
+    float v_t = t;
+    vec2 v_uv = uv;
+
+    // Procedural geometry has no buffers: build the same vertices as
+    // Particles::CreateGeometry from the vertex number
+    if (procedural.w != 0.0) {
+        const int corners[6] = int[6](0, 1, 2, 2, 3, 0);
+        const vec2 positions[4] = vec2[4](vec2(-0.5, 0.5), vec2(0.5, 0.5), vec2(0.5, -0.5), vec2(-0.5, -0.5));
+        const vec2 uvs[4] = vec2[4](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));
+        uint particle = uint(gl_VertexID/6);
+        int corner = corners[gl_VertexID % 6];
+        v_uv = uvs[corner];
+
+        // Batched systems all get the full count; those with less detail
+        // collapse the rest of their quads to a point, which covers no pixels
+        if (float(particle) >= parent_transform.w) {
+            gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+            color_interp = vec4(0.0);
+            uv_interp = v_uv;
+            return;
+        }
+
+        if (procedural.z == 0.0) {
+            // A quad moving along a random direction of the fan
+            float theta = (2.0*random(particle*3u) - 1.0)*procedural.y + 3.14159265;
+            float r = 0.8*random(particle*3u + 1u);
+            v_pos = positions[corner];
+            v_dir = vec2(sin(theta), cos(theta))*r;
+            v_t = random(particle*3u + 2u);
+        }
+        else {
+            // Explosions: every vertex starts at the centre on its own way out
+            uint id = particle*4u + uint(corner);
+            v_pos = vec2(0.0);
+            v_dir = vec2(random(id*3u), random(id*3u + 1u))*0.5 - 0.25;
+            v_t = random(id*3u + 2u);
+        }
+    }
+
     vec4 pos; // Vertex position
-    float cycle = 2.0; // Duration of cycle in seconds
-    float speed = 4.0; // Speed adjustment constant
-    float gravity = 2.8; // Gravity in this world
+    float cycle = style.x; // Duration of cycle in seconds
+    float speed = style.y; // Speed adjustment constant
+    float gravity = style.z; // Pull along the system's y axis
     float acttime; // Cyclic time
 
     // Add phase to the time and cycle it
-    acttime = mod(time + t*cycle, cycle);
+    acttime = mod(camera.w + v_t*cycle, cycle);
 
-    // Move particle along given direction
-    pos = vec4(vertex.x + acttime*speed*dir.x , vertex.y + acttime*speed*dir.y , 0.0, 1.0);
+    // Move particle along given direction, pulled by gravity
+    pos = vec4(v_pos.x + acttime*speed*v_dir.x , v_pos.y + acttime*speed*v_dir.y - 0.5*gravity*acttime*acttime, 0.0, 1.0);
 
     // Add wobble effect
-    //pos = vec4(vertex.x + cos(acttime)*speed*dir.x , vertex.y + sin(acttime)*speed*dir.y , 0.0, 1.0);
-
-    // Add gravity
-    //pos = vec4(vertex.x+dir.x*acttime*speed , vertex.y+dir.y*acttime*speed + 0.5*gravity*acttime*acttime, 0.0, 1.0);
+    //pos = vec4(v_pos.x + cos(acttime)*speed*v_dir.x , v_pos.y + sin(acttime)*speed*v_dir.y , 0.0, 1.0);
 
     // No motion, for debug
-    //pos = vec4(vertex.x, vertex.y, 0.0, 1.0);
+    //pos = vec4(v_pos.x, v_pos.y, 0.0, 1.0);
 
-    // Transform vertex position
-    gl_Position = view_matrix*transformation_matrix*pos;
+    // Transform vertex position: scale, rotate and translate in the
+    // parent's frame, then by the parent (same as parent * T * R * S)
+    vec2 local_pos = rotate(pos.xy*transform.w, transform.z) + transform.xy;
+    vec2 world_pos = rotate(local_pos, parent_transform.z) + parent_transform.xy;
+    gl_Position = view_matrix*vec4(world_pos, 0.0, 1.0);
     
     // Set color
     //color_interp = vec4(0.5+0.5*cos(4*acttime),0.5*sin(4*acttime)+0.5,0.5, 1.0);
-    color_interp = vec4(t, 0.0, 0.0, 1.0);
+    color_interp = vec4(tint*v_t, 1.0);
 
     // Transfer texture coordinates
-    uv_interp = uv;
+    uv_interp = v_uv;
 }
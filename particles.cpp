@@ -1,19 +1,70 @@
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <vector>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "particles.h"
+#include "vertex_format.h"
+#include "rng.h"
 
 namespace game {
 
+// Attributes of each packed record (see vertex_format.h)
+static const VertexAttribute vertex_attributes_g[] = {
+    { ATTRIB_VERTEX, 2, GL_SHORT, GL_TRUE, offsetof(ParticleVertex, position) },
+    { ATTRIB_DIR, 2, GL_SHORT, GL_TRUE, offsetof(ParticleVertex, dir) },
+    { ATTRIB_PHASE, 1, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(ParticleVertex, phase) },
+    { ATTRIB_UV, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(ParticleVertex, uv) }
+};
+static const int num_vertex_attributes_g = sizeof(vertex_attributes_g) / sizeof(VertexAttribute);
+
+static const VertexAttribute quad_attributes_g[] = {
+    { ATTRIB_VERTEX, 2, GL_SHORT, GL_TRUE, offsetof(QuadVertex, position) },
+    { ATTRIB_UV, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(QuadVertex, uv) }
+};
+static const int num_quad_attributes_g = sizeof(quad_attributes_g) / sizeof(VertexAttribute);
+
+static const VertexAttribute instance_attributes_g[] = {
+    { ATTRIB_DIR, 2, GL_SHORT, GL_TRUE, offsetof(ParticleInstance, dir) },
+    { ATTRIB_PHASE, 1, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(ParticleInstance, phase) },
+    { ATTRIB_PARTICLE_SIZE, 1, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(ParticleInstance, size) }
+};
+static const int num_instance_attributes_g = sizeof(instance_attributes_g) / sizeof(VertexAttribute);
+
+
+// Pack vertices of 7 floats (position, direction, phase, uv) into the bound
+// GL_ARRAY_BUFFER
+static void UploadVertices(const GLfloat *vertices, int count)
+{
+    std::vector<ParticleVertex> packed(count);
+    for (int i = 0; i < count; i++) {
+        const GLfloat *v = &vertices[i * 7];
+        packed[i].position[0] = glm::packSnorm1x16(v[0]);
+        packed[i].position[1] = glm::packSnorm1x16(v[1]);
+        packed[i].dir[0] = glm::packSnorm1x16(v[2]);
+        packed[i].dir[1] = glm::packSnorm1x16(v[3]);
+        packed[i].phase = glm::packUnorm1x8(v[4]);
+        packed[i].uv[0] = glm::packUnorm1x16(v[5]);
+        packed[i].uv[1] = glm::packUnorm1x16(v[6]);
+    }
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(ParticleVertex), packed.data(), GL_STATIC_DRAW);
+}
+
+
 Particles::Particles(void) : Geometry()
 {
     // Initialize variables with default values
+    vao_ = 0;
     vbo_ = 0;
     ebo_ = 0;
     size_ = 0;
     range_ = 0.13f;
     isExplosion_ = false;
+    layout_ = PARTICLES_BUFFERS;
+    seed_ = 0.0f;
+    instance_vbo_ = 0;
 }
 
 
@@ -21,7 +72,76 @@ Particles::Particles(void) : Geometry()
 
 void Particles::CreateGeometry(void)
 {
-    if (!isExplosion_) {
+    Rng& rng = GetRng(RNG_PARTICLES);
+
+    if (layout_ == PARTICLES_PROCEDURAL) {
+        // Nothing to store: only a seed, taken from the same random stream
+        // so runs stay repeatable, and a vertex count
+        seed_ = (float)(int)(rng.NextFloat() * 65536.0f);
+        size_ = NUM_PARTICLE_QUADS * 6;
+    }
+    else if (layout_ == PARTICLES_INSTANCED) {
+        // The unit quad: position and texture coordinates
+        GLfloat corners[] = {
+            -0.5f,  0.5f,    0.0f, 0.0f, // Top-left
+             0.5f,  0.5f,    1.0f, 0.0f, // Top-right
+             0.5f, -0.5f,    1.0f, 1.0f, // Bottom-right
+            -0.5f, -0.5f,    0.0f, 1.0f  // Bottom-left
+        };
+        QuadVertex quad[4];
+        for (int i = 0; i < 4; i++) {
+            quad[i].position[0] = glm::packSnorm1x16(corners[i * 4 + 0]);
+            quad[i].position[1] = glm::packSnorm1x16(corners[i * 4 + 1]);
+            quad[i].uv[0] = glm::packUnorm1x16(corners[i * 4 + 2]);
+            quad[i].uv[1] = glm::packUnorm1x16(corners[i * 4 + 3]);
+        }
+        GLuint face[] = {
+            0, 1, 2,
+            2, 3, 0
+        };
+
+        // One record per particle: direction (2), phase (1), size (1)
+        // Explosion particles are smaller quads flying every way from the
+        // centre, instead of triangles between vertices flying apart
+        std::vector<ParticleInstance> instances(NUM_PARTICLE_QUADS);
+        float pi = glm::pi<float>();
+        for (int i = 0; i < NUM_PARTICLE_QUADS; i++) {
+            glm::vec2 dir;
+            float size;
+            if (!isExplosion_) {
+                float theta = (2.0f * rng.NextFloat() - 1.0f) * range_ + pi;
+                float r = 0.8f * rng.NextFloat();
+                dir = glm::vec2(sin(theta) * r, cos(theta) * r);
+                size = 1.0f;
+            }
+            else {
+                float dx = rng.Uniform(-0.25f, 0.25f);
+                float dy = rng.Uniform(-0.25f, 0.25f);
+                dir = glm::vec2(dx, dy);
+                size = 0.5f;
+            }
+            instances[i].dir[0] = glm::packSnorm1x16(dir.x);
+            instances[i].dir[1] = glm::packSnorm1x16(dir.y);
+            instances[i].phase = glm::packUnorm1x8(rng.NextFloat());
+            instances[i].size = glm::packUnorm1x8(size);
+        }
+
+        glGenBuffers(1, &vbo_);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+        glGenBuffers(1, &ebo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(face), face, GL_STATIC_DRAW);
+
+        glGenBuffers(1, &instance_vbo_);
+        glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(ParticleInstance), instances.data(), GL_STATIC_DRAW);
+
+        // Indices of one quad, drawn once per particle
+        size_ = 6;
+    }
+    else if (!isExplosion_) {
         // Each particle is a square with four vertices and two triangles
 
     // Number of attributes for vertices and faces
@@ -58,9 +178,9 @@ void Particles::CreateGeometry(void)
             if (i % 4 == 0) {
                 // Get three random values
                 //theta = (two_pi*(rand() % 1000) / 1000.0f);
-                theta = (2.0 * (rand() % 10000) / 10000.0f - 1.0f) * range_ + pi;
-                r = 0.0f + 0.8 * (rand() % 10000) / 10000.0f;
-                tmod = (rand() % 10000) / 10000.0f;
+                theta = (2.0f * rng.NextFloat() - 1.0f) * range_ + pi;
+                r = 0.0f + 0.8f * rng.NextFloat();
+                tmod = rng.NextFloat();
             }
 
             // Copy position from standard sprite
@@ -79,10 +199,10 @@ void Particles::CreateGeometry(void)
             particles[i * vertex_attr + 6] = vertex[(i % 4) * 7 + 6];
         }
 
-        // Initialize all the particle faces
-        GLuint manyfaces[NUM_PARTICLES * 6];
+        // Initialize all the particle faces, one quad per four vertices
+        GLuint manyfaces[NUM_PARTICLE_QUADS * 6];
 
-        for (int i = 0; i < NUM_PARTICLES; i++) {
+        for (int i = 0; i < NUM_PARTICLE_QUADS; i++) {
             for (int j = 0; j < 6; j++) {
                 manyfaces[i * 6 + j] = face[j] + i * 4;
             }
@@ -91,7 +211,7 @@ void Particles::CreateGeometry(void)
         // Create buffer for vertices
         glGenBuffers(1, &vbo_);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(particles), particles, GL_STATIC_DRAW);
+        UploadVertices(particles, NUM_PARTICLES);
 
         // Create buffer for faces (index buffer)
         glGenBuffers(1, &ebo_);
@@ -122,23 +242,26 @@ void Particles::CreateGeometry(void)
 
         // Initialize all the particle vertices and indices
         GLfloat particles[NUM_PARTICLES * vertex_attr];
-        GLuint indices[NUM_PARTICLES * 6];
+        GLuint indices[NUM_PARTICLE_QUADS * 6];
 
         for (int i = 0; i < NUM_PARTICLES; i++) {
             // Set random initial position and velocity
             particles[i * vertex_attr + 0] = 0.0f; // x
             particles[i * vertex_attr + 1] = 0.0f; // y
-            particles[i * vertex_attr + 2] = (rand() % 10000) / 20000.0f - 0.25f; // vx
-            particles[i * vertex_attr + 3] = (rand() % 10000) / 20000.0f - 0.25f; // vy
+            particles[i * vertex_attr + 2] = rng.Uniform(-0.25f, 0.25f); // vx
+            particles[i * vertex_attr + 3] = rng.Uniform(-0.25f, 0.25f); // vy
 
             // Set random lifetime
-            particles[i * vertex_attr + 4] = (rand() % 10000) / 10000.0f; // t
+            particles[i * vertex_attr + 4] = rng.NextFloat(); // t
 
             // Copy texture coordinates from standard sprite
             particles[i * vertex_attr + 5] = vertex[(i % 4) * 7 + 5];
             particles[i * vertex_attr + 6] = vertex[(i % 4) * 7 + 6];
 
-            // Set indices for this particle
+        }
+
+        // One quad per four vertices
+        for (int i = 0; i < NUM_PARTICLE_QUADS; i++) {
             GLuint offset = i * 4;
             for (int j = 0; j < 6; j++) {
                 indices[i * 6 + j] = face[j] + offset;
@@ -148,7 +271,7 @@ void Particles::CreateGeometry(void)
         // Create buffer for vertices
         glGenBuffers(1, &vbo_);
         glBindBuffer(GL_ARRAY_BUFFER, vbo_);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(particles), particles, GL_STATIC_DRAW);
+        UploadVertices(particles, NUM_PARTICLES);
 
         // Create buffer for indices (element buffer)
         glGenBuffers(1, &ebo_);
@@ -159,18 +282,68 @@ void Particles::CreateGeometry(void)
         size_ = sizeof(indices) / sizeof(GLuint);
     }
 
-    
+    // Record the attribute layout once (procedural particles still need
+    // a vertex array bound to draw, even an empty one)
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+    SetAttributes();
+    glBindVertexArray(0);
+}
+
+
+void Particles::Draw(float detail){
 
-    
+    int count = std::max((int)(NUM_PARTICLE_QUADS * std::min(detail, 1.0f)), 1);
+    if (layout_ == PARTICLES_INSTANCED) {
+        glDrawElementsInstanced(GL_TRIANGLES, size_, GL_UNSIGNED_INT, 0, count);
+        return;
+    }
+
+    // The other layouts have no size per particle (the attribute's value
+    // is not part of the vertex array, so set it on every draw)
+    glVertexAttrib1f(ATTRIB_PARTICLE_SIZE, 1.0f);
+
+    // Six vertices per particle, two triangles of a quad
+    if (layout_ == PARTICLES_PROCEDURAL) {
+        glDrawArrays(GL_TRIANGLES, 0, count * 6);
+        return;
+    }
+    glDrawElements(GL_TRIANGLES, count * 6, GL_UNSIGNED_INT, 0);
 }
 
 
-void Particles::SetGeometry(GLuint shader_program){
+void Particles::DrawBatch(int count){
+
+    glVertexAttrib1f(ATTRIB_PARTICLE_SIZE, 1.0f);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, size_, count);
+}
 
-    // Set blending
-    glDisable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_ONE, GL_ONE);
+
+glm::vec4 Particles::GetProcedural(void){
+
+    if (layout_ != PARTICLES_PROCEDURAL) {
+        return glm::vec4(0.0f);
+    }
+    return glm::vec4(seed_, range_, isExplosion_ ? 1.0f : 0.0f, 1.0f);
+}
+
+
+void Particles::SetAttributes(void){
+
+    // No vertex buffers to point at
+    if (layout_ == PARTICLES_PROCEDURAL) {
+        return;
+    }
+
+    if (layout_ == PARTICLES_INSTANCED) {
+        // The quad's corners, then direction, phase and size once per quad
+        glBindBuffer(GL_ARRAY_BUFFER, vbo_);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
+        SetVertexAttributes(quad_attributes_g, num_quad_attributes_g, sizeof(QuadVertex));
+        glBindBuffer(GL_ARRAY_BUFFER, instance_vbo_);
+        SetVertexAttributes(instance_attributes_g, num_instance_attributes_g, sizeof(ParticleInstance), 0, 1);
+        return;
+    }
 
     // Bind buffers
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
@@ -178,24 +351,7 @@ void Particles::SetGeometry(GLuint shader_program){
 
     // Set attributes for shaders
     // Should be consistent with how we created the buffers for the particle elements
-    GLint vertex_att = glGetAttribLocation(shader_program, "vertex");
-    glVertexAttribPointer(vertex_att, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(vertex_att);
-
-    // Direction
-    GLint dir_att = glGetAttribLocation(shader_program, "dir");
-    glVertexAttribPointer(dir_att, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void *)(2 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(dir_att);
-
-    // Phase 
-    GLint time_att = glGetAttribLocation(shader_program, "t");
-    glVertexAttribPointer(time_att, 1, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void *)(4 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(time_att);
-
-    // Texture coordinates
-    GLint tex_att = glGetAttribLocation(shader_program, "uv");
-    glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void *)(5 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(tex_att);
+    SetVertexAttributes(vertex_attributes_g, num_vertex_attributes_g, sizeof(ParticleVertex));
 }
 
 } // namespace game
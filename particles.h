@@ -3,10 +3,20 @@
 
 #include "geometry.h"
 
+// Vertices of the stored geometry; four make a quad, so a system has
+// NUM_PARTICLE_QUADS particles in every layout
 #define NUM_PARTICLES 4000
+#define NUM_PARTICLE_QUADS (NUM_PARTICLES / 4)
 
 namespace game {
 
+    // Where the particle vertices come from
+    enum ParticleLayout {
+        PARTICLES_BUFFERS,      // Four stored vertices and six indices per particle
+        PARTICLES_PROCEDURAL,   // Generated in the vertex shader from gl_VertexID
+        PARTICLES_INSTANCED     // One shared quad, one record per particle
+    };
+
     // A set of particles that can be rendered
     class Particles : public Geometry {
 
@@ -16,11 +26,36 @@ namespace game {
             // Create the geometry (called once)
             void CreateGeometry(void);
 
-            // Use the geometry
-            void SetGeometry(GLuint shader_program);
+            // Point the attribute slots at the buffers
+            void SetAttributes(void);
+
+            // Choose how the particles are stored; call before CreateGeometry
+            // Procedural particles are derived from gl_VertexID and a seed in
+            // the vertex shader, so the geometry takes no buffers at all
+            // Instanced particles draw one shared quad per record of
+            // direction, phase and size, instead of repeating them per vertex
+            inline void SetLayout(ParticleLayout layout) { layout_ = layout; }
+
+            // Draw the particles in the geometry's layout, only the first
+            // detail fraction of them (they are in random order, so any
+            // fraction is spread over the whole system)
+            void Draw(float detail = 1.0f) override;
+
+            // One copy per batched system, only for procedural particles
+            // (the other layouts already use the instance or keep their own
+            // buffers per system)
+            void DrawBatch(int count) override;
+
+            // Seed (x), direction range (y), explosion (z) and 1 (w) when
+            // procedural, zeros otherwise
+            glm::vec4 GetProcedural(void) override;
 
+        private:
+            ParticleLayout layout_;
+            float seed_;
 
-            
+            // Per-particle records of instanced particles
+            GLuint instance_vbo_;
 
     }; // class Particles
 } // namespace game
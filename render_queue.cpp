@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cstring>
+
+#include "render_queue.h"
+
+namespace game {
+
+// Depth between two consecutive sprites, enough for 100000+ sprites a frame
+static const float depth_step_g = 2.0f / 131072.0f;
+
+// Field positions in the sort key
+static const int key_pass_shift_g = 62;
+static const int key_shader_shift_g = 54;
+static const int key_texture_shift_g = 38;
+static const uint64_t key_state_mask_g = ~((uint64_t(1) << key_texture_shift_g) - 1);
+
+
+RenderQueue::RenderQueue(void)
+{
+    atlas_ = nullptr;
+    particle_budget_ = nullptr;
+    sequence_ = 0;
+    draw_count_ = 0;
+    state_change_count_ = 0;
+    batched_particle_count_ = 0;
+    next_item_ = 0;
+    next_sprite_ = 0;
+    emitters_begin_ = 0;
+    emitters_end_ = 0;
+}
+
+
+void RenderQueue::Init(Geometry *quad)
+{
+    sprite_batch_.Init(quad);
+    emitter_uniforms_.Init();
+}
+
+
+void RenderQueue::SetAtlas(const TextureAtlas *atlas)
+{
+    atlas_ = atlas;
+}
+
+
+void RenderQueue::Begin(void)
+{
+    items_.clear();
+    sprites_.clear();
+    particles_.clear();
+    sequence_ = 0;
+}
+
+
+int RenderQueue::ShaderId(Shader *shader, ItemKind kind)
+{
+    std::unordered_map<Shader*, int>::iterator it = shader_ids_.find(shader);
+    if (it != shader_ids_.end()) {
+        return it->second;
+    }
+
+    // Only look up the uniforms this kind of item sets, so there are no
+    // warnings about the others
+    ShaderEntry entry;
+    entry.shader = shader;
+    if (kind == ITEM_PARTICLES) {
+        entry.emitter_first = shader->GetUniform<int>("emitter_first");
+        entry.emitter_per_instance = shader->GetUniform<int>("emitter_per_instance");
+    }
+
+    int id = (int)shaders_.size();
+    shaders_.push_back(entry);
+    shader_ids_[shader] = id;
+    return id;
+}
+
+
+int RenderQueue::TextureId(GLuint texture)
+{
+    std::unordered_map<GLuint, int>::iterator it = texture_ids_.find(texture);
+    if (it != texture_ids_.end()) {
+        return it->second;
+    }
+
+    int id = (int)textures_.size();
+    textures_.push_back(texture);
+    texture_ids_[texture] = id;
+    return id;
+}
+
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, int shader, int texture)
+{
+    return (uint64_t(pass) << key_pass_shift_g) |
+        (uint64_t(shader & 0xff) << key_shader_shift_g) |
+        (uint64_t(texture & 0xffff) << key_texture_shift_g) |
+        (sequence_++ & ((uint64_t(1) << key_texture_shift_g) - 1));
+}
+
+
+void RenderQueue::AddSprite(Shader *shader, GLuint texture, const SpriteInstance &instance)
+{
+    sprites_.push_back(instance);
+    SpriteInstance &added = sprites_.back();
+    added.depth = std::min(-1.0f + sprites_.size() * depth_step_g, 1.0f);
+
+    // Map the uv rect into the image's area of its atlas page
+    AtlasRegion region;
+    if (atlas_ && atlas_->Find(texture, region)) {
+        texture = region.texture;
+        added.layer = region.layer;
+        added.uv_rect = glm::vec4(region.uv_rect.x + added.uv_rect.x * region.uv_rect.z,
+            region.uv_rect.y + added.uv_rect.y * region.uv_rect.w,
+            added.uv_rect.z * region.uv_rect.z,
+            added.uv_rect.w * region.uv_rect.w);
+    }
+
+    Item item;
+    item.key = MakeKey(PASS_SPRITES, ShaderId(shader, ITEM_SPRITE), TextureId(texture));
+    item.kind = ITEM_SPRITE;
+    item.index = (int)sprites_.size() - 1;
+    items_.push_back(item);
+}
+
+
+void RenderQueue::AddParticles(Shader *shader, Geometry *geometry, GLuint texture, const glm::vec4 &transform, const glm::vec3 &parent_transform,
+    const glm::vec4 &style, const glm::vec3 &tint, float detail)
+{
+    ParticleDraw draw;
+    draw.geometry = geometry;
+    draw.transform = transform;
+    draw.parent_transform = parent_transform;
+    draw.style = style;
+    draw.tint = tint;
+    draw.detail = detail;
+    particles_.push_back(draw);
+
+    Item item;
+    item.key = MakeKey(PASS_PARTICLES, ShaderId(shader, ITEM_PARTICLES), TextureId(texture));
+    item.kind = ITEM_PARTICLES;
+    item.index = (int)particles_.size() - 1;
+    items_.push_back(item);
+}
+
+
+void RenderQueue::RadixSort(void)
+{
+    scratch_.resize(items_.size());
+
+    // Each pass is stable and items are added in sequence order, so the
+    // bytes holding only the sequence never need sorting
+    for (int shift = key_texture_shift_g & ~7; shift < 64; shift += 8) {
+        size_t counts[256];
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < items_.size(); i++) {
+            counts[(items_[i].key >> shift) & 0xff]++;
+        }
+
+        // Every key has the same byte here (e.g. unused high bits), nothing to do
+        if (counts[(items_[0].key >> shift) & 0xff] == items_.size()) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t count = counts[b];
+            counts[b] = offset;
+            offset += count;
+        }
+        for (size_t i = 0; i < items_.size(); i++) {
+            scratch_[counts[(items_[i].key >> shift) & 0xff]++] = items_[i];
+        }
+        items_.swap(scratch_);
+    }
+}
+
+
+void RenderQueue::UploadEmitters(size_t first)
+{
+    int count = 0;
+    while (first + count < items_.size() && count < MAX_BATCH_EMITTERS && items_[first + count].kind == ITEM_PARTICLES) {
+        const ParticleDraw &draw = particles_[items_[first + count].index];
+
+        // Batched systems draw every particle, the shader drops those past
+        // the count (six vertices per particle, the same as Particles::Draw)
+        int particles = std::max((int)(draw.geometry->GetSize() / 6 * std::min(draw.detail, 1.0f)), 1);
+
+        emitter_data_.transform[count] = draw.transform;
+        emitter_data_.parent[count] = glm::vec4(draw.parent_transform, (float)particles);
+        emitter_data_.style[count] = draw.style;
+        emitter_data_.tint[count] = glm::vec4(draw.tint, 1.0f);
+        emitter_data_.procedural[count] = draw.geometry->GetProcedural();
+        count++;
+    }
+    emitter_uniforms_.Update(emitter_data_, count);
+
+    emitters_begin_ = first;
+    emitters_end_ = first + count;
+}
+
+
+void RenderQueue::Submit(void)
+{
+    Sort();
+    SubmitPass(PASS_SPRITES);
+    SubmitPass(PASS_PARTICLES);
+}
+
+
+void RenderQueue::Sort(void)
+{
+    draw_count_ = 0;
+    state_change_count_ = 0;
+    batched_particle_count_ = 0;
+    next_item_ = 0;
+    next_sprite_ = 0;
+    emitters_begin_ = 0;
+    emitters_end_ = 0;
+    if (items_.empty()) {
+        return;
+    }
+
+    RadixSort();
+
+    // Sprites are written straight into the instance buffer in sorted
+    // order, so every run of sprites with the same state is one contiguous range
+    if (!sprites_.empty()) {
+        SpriteInstance *instances = sprite_batch_.Begin(sprites_.size());
+        for (size_t i = 0; i < items_.size(); i++) {
+            if (items_[i].kind == ITEM_SPRITE) {
+                *instances++ = sprites_[items_[i].index];
+            }
+        }
+        sprite_batch_.End();
+    }
+}
+
+
+void RenderQueue::SubmitPass(RenderPass pass)
+{
+    // Each pass starts with no state known, it may follow other drawing
+    uint64_t current_state = ~uint64_t(0);
+    ShaderEntry *entry = nullptr;
+    int current_shader = -1;
+    GLuint current_texture = 0;
+
+    // Items are sorted by pass first, so a pass is the next run of items
+    size_t i = next_item_;
+    while (i < items_.size()) {
+        uint64_t key = items_[i].key;
+        uint64_t state = key & key_state_mask_g;
+        if ((RenderPass)(key >> key_pass_shift_g) != pass) {
+            break;
+        }
+
+        // Only change what differs from the previous item
+        if (state != current_state) {
+            int shader = (int)((key >> key_shader_shift_g) & 0xff);
+            GLuint texture = textures_[(key >> key_texture_shift_g) & 0xffff];
+
+            SetRenderPass(pass);
+            if (shader != current_shader) {
+                entry = &shaders_[shader];
+                entry->shader->Enable();
+                current_shader = shader;
+            }
+            if (texture != current_texture) {
+                // Sprite textures are all arrays (the atlas or single layers)
+                glBindTexture(pass == PASS_SPRITES ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D, texture);
+                current_texture = texture;
+            }
+            current_state = state;
+            state_change_count_++;
+        }
+
+        if (items_[i].kind == ITEM_SPRITE) {
+            // All the following sprites with the same state in one call
+            size_t count = 1;
+            while (i + count < items_.size() && items_[i + count].kind == ITEM_SPRITE &&
+                (items_[i + count].key & key_state_mask_g) == state) {
+                count++;
+            }
+            sprite_batch_.Draw(next_sprite_, count);
+            next_sprite_ += count;
+            i += count;
+        }
+        else {
+            if (i >= emitters_end_) {
+                UploadEmitters(i);
+            }
+            const ParticleDraw &draw = particles_[items_[i].index];
+            entry->shader->Set(entry->emitter_first, (int)(i - emitters_begin_));
+            draw.geometry->SetGeometry();
+
+            // All the following procedural systems with the same state and
+            // in the same block in one call, one instance each
+            size_t count = 1;
+            if (draw.geometry->GetProcedural().w != 0.0f) {
+                while (i + count < emitters_end_ && (items_[i + count].key & key_state_mask_g) == state) {
+                    Geometry *geometry = particles_[items_[i + count].index].geometry;
+                    if (geometry->GetProcedural().w == 0.0f || geometry->GetSize() != draw.geometry->GetSize()) {
+                        break;
+                    }
+                    count++;
+                }
+            }
+
+            if (count > 1) {
+                entry->shader->Set(entry->emitter_per_instance, 1);
+                draw.geometry->DrawBatch((int)count);
+                batched_particle_count_ += (int)count;
+            }
+            else {
+                entry->shader->Set(entry->emitter_per_instance, 0);
+                draw.geometry->Draw(draw.detail);
+            }
+            i += count;
+        }
+        draw_count_++;
+    }
+    next_item_ = i;
+
+    glBindVertexArray(0);
+}
+
+
+void RenderQueue::Report(void)
+{
+    sprite_batch_.Report();
+}
+
+} // namespace game
@@ -0,0 +1,160 @@
+#ifndef RENDER_QUEUE_H_
+#define RENDER_QUEUE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+#include "shader.h"
+#include "geometry.h"
+#include "sprite_batch.h"
+#include "texture_atlas.h"
+#include "render_state.h"
+#include "particle_budget.h"
+#include "emitter_uniforms.h"
+
+namespace game {
+
+    // Collects everything to draw in a frame, sorts it by the state it needs
+    // and draws it with as few state changes as possible
+    //
+    // Each item gets a 64 bit key, most significant first:
+    //   pass (2) | shader (8) | texture (16) | sequence (38)
+    // The pass sets the depth and blend state. The sequence is the order items were added in, so items needing the
+    // same state keep their order. Sprites get a depth from it, which keeps
+    // "first drawn wins" no matter how they are grouped. Particles come
+    // after all sprites, as they do in the object list, and are additive,
+    // so grouping them by state does not change the result
+    //
+    // The values of queued particle systems go into one uniform block
+    // (EmitterData), up to MAX_BATCH_EMITTERS at a time. Systems with
+    // procedural geometry and the same state are then a single instanced
+    // draw, each instance reading its own entry, so their CPU cost does not
+    // grow with their number
+    class RenderQueue {
+
+        public:
+            RenderQueue(void);
+
+            // Draw sprites with the given unit quad (needs an OpenGL context)
+            void Init(Geometry *quad);
+
+            // Textures packed in the atlas are drawn from their atlas page
+            void SetAtlas(const TextureAtlas *atlas);
+
+            // Budget the particle systems share, which they ask for their
+            // level of detail when queued; null (the default) for no limit
+            inline void SetParticleBudget(ParticleBudget *budget) { particle_budget_ = budget; }
+            inline ParticleBudget *GetParticleBudget(void) { return particle_budget_; }
+
+            // Start a frame
+            // The view and time come from the shared frame uniform block
+            void Begin(void);
+
+            // Queue a sprite
+            void AddSprite(Shader *shader, GLuint texture, const SpriteInstance &instance);
+
+            // Queue a particle system drawn with its own geometry
+            // transform is position (xy), angle (z) and scale (w) in the
+            // parent's frame; parent_transform is the parent's position (xy)
+            // and angle (z). The vertex shader builds the matrix from them
+            // style is the cycle (x), speed (y) and gravity (z) of the
+            // particles, and detail the fraction of them to draw
+            void AddParticles(Shader *shader, Geometry *geometry, GLuint texture, const glm::vec4 &transform, const glm::vec3 &parent_transform,
+                const glm::vec4 &style, const glm::vec3 &tint, float detail = 1.0f);
+
+            // Particle systems drawn with a single instanced call along
+            // with others, over the last submitted frame
+            inline int GetBatchedParticleCount(void) const { return batched_particle_count_; }
+
+            // Sort and draw everything queued
+            void Submit(void);
+
+            // The same in steps, so the passes can be drawn to different
+            // targets: sort, then draw one pass at a time in pass order
+            void Sort(void);
+            void SubmitPass(RenderPass pass);
+
+            // Print the statistics of the buffers the queue streams through
+            void Report(void);
+
+            // Statistics of the last submitted frame
+            inline int GetDrawCount(void) const { return draw_count_; }
+            inline int GetStateChangeCount(void) const { return state_change_count_; }
+
+        private:
+            enum ItemKind { ITEM_SPRITE, ITEM_PARTICLES };
+
+            struct Item {
+                uint64_t key;
+                ItemKind kind;
+                int index;          // Into sprites_ or particles_
+            };
+
+            struct ParticleDraw {
+                Geometry *geometry;
+                glm::vec4 transform;
+                glm::vec3 parent_transform;
+                glm::vec4 style;
+                glm::vec3 tint;
+                float detail;
+            };
+
+            // A shader seen by the queue, with the handles it needs
+            struct ShaderEntry {
+                Shader *shader;
+                Uniform<int> emitter_first;
+                Uniform<int> emitter_per_instance;
+            };
+
+            // Small ids for the sort key, kept for the whole run
+            int ShaderId(Shader *shader, ItemKind kind);
+            int TextureId(GLuint texture);
+
+            // Build a key from its fields
+            uint64_t MakeKey(RenderPass pass, int shader, int texture);
+
+            // Sort items_ by key, least significant byte first
+            void RadixSort(void);
+
+            // Write the particle items from first on (up to a full block) to
+            // the emitter block, in item order
+            void UploadEmitters(size_t first);
+
+            const TextureAtlas *atlas_;
+            ParticleBudget *particle_budget_;
+            SpriteBatch sprite_batch_;
+            EmitterUniforms emitter_uniforms_;
+            EmitterData emitter_data_;
+
+            std::vector<Item> items_;
+            std::vector<Item> scratch_;
+            std::vector<SpriteInstance> sprites_;
+            std::vector<ParticleDraw> particles_;
+            uint64_t sequence_;
+
+            std::vector<ShaderEntry> shaders_;
+            std::unordered_map<Shader*, int> shader_ids_;
+            std::vector<GLuint> textures_;
+            std::unordered_map<GLuint, int> texture_ids_;
+
+            int draw_count_;
+            int state_change_count_;
+            int batched_particle_count_;
+
+            // Where SubmitPass() goes on from, and the next sprite instance
+            size_t next_item_;
+            size_t next_sprite_;
+
+            // Items whose particle systems are in the emitter block
+            size_t emitters_begin_;
+            size_t emitters_end_;
+
+    }; // class RenderQueue
+
+} // namespace game
+
+#endif // RENDER_QUEUE_H_
@@ -0,0 +1,40 @@
+#include "render_state.h"
+
+namespace game {
+
+// Pass whose state is currently set
+static RenderPass current_pass_g = PASS_NONE;
+
+
+void SetRenderPass(RenderPass pass)
+{
+    if (pass == current_pass_g) {
+        return;
+    }
+    current_pass_g = pass;
+
+    switch (pass) {
+        case PASS_SPRITES:
+            // No blending
+            glEnable(GL_DEPTH_TEST);
+            glDepthFunc(GL_LESS);
+            glDisable(GL_BLEND);
+            break;
+        case PASS_PARTICLES:
+            // Set blending
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            break;
+        default:
+            break;
+    }
+}
+
+
+void ResetRenderPass(void)
+{
+    current_pass_g = PASS_NONE;
+}
+
+} // namespace game
@@ -0,0 +1,25 @@
+#ifndef RENDER_STATE_H_
+#define RENDER_STATE_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+
+namespace game {
+
+    // Depth and blend state for each kind of drawing
+    enum RenderPass {
+        PASS_NONE,
+        PASS_SPRITES,       // Depth tested, no blending
+        PASS_PARTICLES      // No depth test, additive blending
+    };
+
+    // Switch to the state of a pass, doing nothing if it is already set
+    void SetRenderPass(RenderPass pass);
+
+    // Forget the current pass, e.g. at the start of a frame or after code
+    // that changes the state on its own
+    void ResetRenderPass(void);
+
+} // namespace game
+
+#endif // RENDER_STATE_H_
@@ -0,0 +1,90 @@
+#include <random>
+
+#include "rng.h"
+
+namespace game {
+
+// Seed that all system streams were derived from
+static uint64_t run_seed_g = 0;
+
+// One generator per system, each on its own PCG stream
+static Rng streams_g[NUM_RANDOM_STREAMS];
+
+
+Rng::Rng(uint64_t seed, uint64_t stream)
+{
+    Seed(seed, stream);
+}
+
+
+void Rng::Seed(uint64_t seed, uint64_t stream)
+{
+    // Standard PCG32 seeding: the stream selects the (odd) increment
+    state_ = 0u;
+    inc_ = (stream << 1u) | 1u;
+    NextUint();
+    state_ += seed;
+    NextUint();
+}
+
+
+uint32_t Rng::NextUint(void)
+{
+    // Advance the LCG, then permute the old state for the output
+    uint64_t oldstate = state_;
+    state_ = oldstate * 6364136223846793005ULL + inc_;
+    uint32_t xorshifted = (uint32_t)(((oldstate >> 18u) ^ oldstate) >> 27u);
+    uint32_t rot = (uint32_t)(oldstate >> 59u);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+
+float Rng::NextFloat(void)
+{
+    // Use the top 24 bits so every value is exactly representable
+    return (NextUint() >> 8) * (1.0f / 16777216.0f);
+}
+
+
+float Rng::Uniform(float lo, float hi)
+{
+    return lo + (hi - lo) * NextFloat();
+}
+
+
+int Rng::UniformInt(int lo, int hi)
+{
+    // Multiply-shift maps the 32 bit value onto the range without a division
+    uint32_t range = (uint32_t)(hi - lo);
+    return lo + (int)(((uint64_t)NextUint() * range) >> 32);
+}
+
+
+void SetRunSeed(uint64_t seed)
+{
+    run_seed_g = seed;
+    for (int i = 0; i < NUM_RANDOM_STREAMS; i++) {
+        streams_g[i].Seed(seed, i);
+    }
+}
+
+
+uint64_t GetRunSeed(void)
+{
+    return run_seed_g;
+}
+
+
+uint64_t MakeRandomSeed(void)
+{
+    std::random_device rand_device;
+    return ((uint64_t)rand_device() << 32) | rand_device();
+}
+
+
+Rng &GetRng(RandomStream stream)
+{
+    return streams_g[stream];
+}
+
+} // namespace game
@@ -0,0 +1,65 @@
+#ifndef RNG_H_
+#define RNG_H_
+
+#include <cstdint>
+
+namespace game {
+
+    // Each system draws from its own stream so that, for example, firing more
+    // bullets never changes where the next wave of enemies spawns
+    enum RandomStream {
+        RNG_ENEMY_SPAWN,
+        RNG_COLLECTIBLE_SPAWN,
+        RNG_PARTICLES,
+        NUM_RANDOM_STREAMS
+    };
+
+    // A small PCG32 generator (pcg-random.org)
+    // 16 bytes of state, no system calls, and independent streams can be
+    // selected without any correlation between them
+    class Rng {
+
+        public:
+            // Constructor
+            Rng(uint64_t seed = 0, uint64_t stream = 0);
+
+            // Restart the generator on a given seed and stream
+            void Seed(uint64_t seed, uint64_t stream);
+
+            // Uniform 32 bit integer
+            uint32_t NextUint(void);
+
+            // Uniform float in [0, 1)
+            float NextFloat(void);
+
+            // Uniform float in [lo, hi)
+            float Uniform(float lo, float hi);
+
+            // Uniform integer in [lo, hi)
+            int UniformInt(int lo, int hi);
+
+            // Raw state, used to save and restore a generator exactly
+            inline uint64_t GetState(void) const { return state_; }
+            inline uint64_t GetIncrement(void) const { return inc_; }
+            inline void SetState(uint64_t state, uint64_t inc) { state_ = state; inc_ = inc; }
+
+        private:
+            uint64_t state_;
+            uint64_t inc_;
+
+    }; // class Rng
+
+    // Seed every system stream from a single run seed
+    // Call this once before the game is set up; the same seed gives the same run
+    void SetRunSeed(uint64_t seed);
+    uint64_t GetRunSeed(void);
+
+    // Pick a run seed from the system entropy source (only used once per run)
+    uint64_t MakeRandomSeed(void);
+
+    // Get the generator owned by a system
+    Rng &GetRng(RandomStream stream);
+
+} // namespace game
+
+#endif // RNG_H_
@@ -7,6 +7,19 @@
 
 namespace game {
 
+// Attribute name for each AttributeSlot
+static const char *attribute_names_g[NUM_ATTRIBUTE_SLOTS] = {
+    "vertex", "dir", "t", "uv",
+    "instance_transform", "instance_uv_rect", "instance_tint", "instance_layer_depth",
+    "particle", "particle_age", "size"
+};
+
+// Block name for each UniformBlockBinding
+static const char *uniform_block_names_g[NUM_UNIFORM_BLOCKS] = {
+    "Frame", "Emitters"
+};
+
+
 Shader::Shader(void)
 {
     // Don't do work in the constructor, leave it for the Init() function
@@ -16,16 +29,13 @@ Shader::Shader(void)
 }
 
 
-void Shader::Init(const char *vertPath, const char *fragPath)
+void Shader::Init(const char *vertPath, const char *fragPath, const char **feedback_varyings, int feedback_count)
 {
    
     // Load shader program source code
     // Vertex program
     std::string vp = LoadTextFile(vertPath);
     const char *source_vp = vp.c_str();
-    // Fragment program
-    std::string fp = LoadTextFile(fragPath);
-    const char *source_fp = fp.c_str();
 
     // Create a shader from vertex program source code
     GLuint vs = glCreateShader(GL_VERTEX_SHADER);
@@ -42,23 +52,36 @@ void Shader::Init(const char *vertPath, const char *fragPath)
     }
 
     // Create a shader from the fragment program source code
-    GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &source_fp, NULL);
-    glCompileShader(fs);
-
-    // Check if shader compiled successfully
-    glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE) {
-        char buffer[512];
-        glGetShaderInfoLog(fs, 512, NULL, buffer);
-        throw(std::ios_base::failure(std::string("Error compiling fragment shader: ") + std::string(buffer)));
+    GLuint fs = 0;
+    if (fragPath) {
+        std::string fp = LoadTextFile(fragPath);
+        const char *source_fp = fp.c_str();
+        fs = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fs, 1, &source_fp, NULL);
+        glCompileShader(fs);
+
+        // Check if shader compiled successfully
+        glGetShaderiv(fs, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE) {
+            char buffer[512];
+            glGetShaderInfoLog(fs, 512, NULL, buffer);
+            throw(std::ios_base::failure(std::string("Error compiling fragment shader: ") + std::string(buffer)));
+        }
     }
 
     // Create a shader program linking both vertex and fragment shaders
     // together
     shader_program_ = glCreateProgram();
     glAttachShader(shader_program_, vs);
-    glAttachShader(shader_program_, fs);
+    if (fs) {
+        glAttachShader(shader_program_, fs);
+    }
+    for (int i = 0; i < NUM_ATTRIBUTE_SLOTS; i++) {
+        glBindAttribLocation(shader_program_, i, attribute_names_g[i]);
+    }
+    if (feedback_count > 0) {
+        glTransformFeedbackVaryings(shader_program_, feedback_count, feedback_varyings, GL_INTERLEAVED_ATTRIBS);
+    }
     glLinkProgram(shader_program_);
 
     // Check if shaders were linked successfully
@@ -72,55 +95,232 @@ void Shader::Init(const char *vertPath, const char *fragPath)
     // Delete memory used by shaders, since they were already compiled
     // and linked
     glDeleteShader(vs);
-    glDeleteShader(fs);
+    if (fs) {
+        glDeleteShader(fs);
+    }
+
+    // Blocks the program does not use are simply not there
+    for (int i = 0; i < NUM_UNIFORM_BLOCKS; i++) {
+        GLuint index = glGetUniformBlockIndex(shader_program_, uniform_block_names_g[i]);
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shader_program_, index, i);
+        }
+    }
+
+    Reflect();
+}
+
+
+void Shader::InitCompute(const char *compPath)
+{
+    // Load and compile the compute program
+    std::string cp = LoadTextFile(compPath);
+    const char *source_cp = cp.c_str();
+    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(cs, 1, &source_cp, NULL);
+    glCompileShader(cs);
+
+    // Check if shader compiled successfully
+    GLint status;
+    glGetShaderiv(cs, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char buffer[512];
+        glGetShaderInfoLog(cs, 512, NULL, buffer);
+        throw(std::ios_base::failure(std::string("Error compiling compute shader: ") + std::string(buffer)));
+    }
+
+    shader_program_ = glCreateProgram();
+    glAttachShader(shader_program_, cs);
+    glLinkProgram(shader_program_);
+
+    // Check if the program was linked successfully
+    glGetProgramiv(shader_program_, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char buffer[512];
+        glGetProgramInfoLog(shader_program_, 512, NULL, buffer);
+        throw(std::ios_base::failure(std::string("Error linking compute shader: ") + std::string(buffer)));
+    }
+
+    glDeleteShader(cs);
+
+    Reflect();
+}
+
+
+void Shader::Reflect(void)
+{
+    uniforms_.clear();
+    attributes_.clear();
+    warned_.clear();
+
+    GLchar name[256];
+    GLsizei length;
+    GLint size;
+    Variable variable;
+
+    GLint count = 0;
+    glGetProgramiv(shader_program_, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; i++) {
+        glGetActiveUniform(shader_program_, i, sizeof(name), &length, &size, &variable.type, name);
+        variable.location = glGetUniformLocation(shader_program_, name);
+
+        // Arrays are reported as "name[0]"; store them as "name"
+        std::string key(name, length);
+        if (key.size() > 3 && key.compare(key.size() - 3, 3, "[0]") == 0) {
+            key.resize(key.size() - 3);
+        }
+        uniforms_[key] = variable;
+    }
+
+    count = 0;
+    glGetProgramiv(shader_program_, GL_ACTIVE_ATTRIBUTES, &count);
+    for (GLint i = 0; i < count; i++) {
+        glGetActiveAttrib(shader_program_, i, sizeof(name), &length, &size, &variable.type, name);
+        variable.location = glGetAttribLocation(shader_program_, name);
+        attributes_[std::string(name, length)] = variable;
+    }
+}
+
+
+void Shader::Warn(const std::string &name, const std::string &message)
+{
+    if (warned_.insert(name).second) {
+        std::cerr << "Warning: shader program " << shader_program_ << ": " << message << std::endl;
+    }
+}
+
+
+GLint Shader::FindUniform(const GLchar *name, GLenum expected_type)
+{
+    std::unordered_map<std::string, Variable>::iterator it = uniforms_.find(name);
+    if (it == uniforms_.end()) {
+        Warn(name, std::string("no active uniform named ") + name);
+        return -1;
+    }
+
+    // Samplers and booleans are set as integers
+    GLenum type = it->second.type;
+    bool is_int = (type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D || type == GL_SAMPLER_2D_ARRAY);
+    if (expected_type != 0 && type != expected_type && !(expected_type == GL_INT && is_int)) {
+        Warn(name, std::string("uniform ") + name + " has a different type than its handle");
+    }
+    return it->second.location;
+}
+
+
+Attribute Shader::GetAttribute(const GLchar *name)
+{
+    Attribute attribute;
+    std::unordered_map<std::string, Variable>::iterator it = attributes_.find(name);
+    if (it == attributes_.end()) {
+        Warn(name, std::string("no active attribute named ") + name);
+    }
+    else {
+        attribute.location = it->second.location;
+    }
+    return attribute;
+}
+
+
+void Shader::Set(Uniform<int> uniform, int value)
+{
+
+    glUniform1i(uniform.location, value);
+}
+
+
+void Shader::Set(Uniform<float> uniform, float value)
+{
+
+    glUniform1f(uniform.location, value);
+}
+
+
+void Shader::Set(Uniform<glm::vec2> uniform, const glm::vec2 &vector)
+{
+
+    glUniform2f(uniform.location, vector.x, vector.y);
+}
+
+
+void Shader::Set(Uniform<glm::vec3> uniform, const glm::vec3 &vector)
+{
+
+    glUniform3f(uniform.location, vector.x, vector.y, vector.z);
+}
+
+
+void Shader::Set(Uniform<glm::vec4> uniform, const glm::vec4 &vector)
+{
+
+    glUniform4f(uniform.location, vector.x, vector.y, vector.z, vector.w);
+}
+
+
+void Shader::Set(Uniform<glm::mat4> uniform, const glm::mat4 &matrix)
+{
+
+    glUniformMatrix4fv(uniform.location, 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+
+void Shader::Set(Uniform<glm::vec4> uniform, const glm::vec4 *vectors, int count)
+{
+
+    glUniform4fv(uniform.location, count, glm::value_ptr(vectors[0]));
 }
 
 
 void Shader::SetUniform1i(const GLchar *name, int value)
 {
 
-    glUniform1i(glGetUniformLocation(shader_program_, name), value);
+    glUniform1i(FindUniform(name, 0), value);
 }
 
 
 void Shader::SetUniform1f(const GLchar *name, float value)
 {
 
-    glUniform1f(glGetUniformLocation(shader_program_, name), value);
+    glUniform1f(FindUniform(name, 0), value);
 }
 
 
 void Shader::SetUniform2f(const GLchar *name, const glm::vec2 &vector)
 {
 
-    glUniform2f(glGetUniformLocation(shader_program_, name), vector.x, vector.y);
+    glUniform2f(FindUniform(name, 0), vector.x, vector.y);
 }
 
 
 void Shader::SetUniform3f(const GLchar *name, const glm::vec3 &vector)
 {
 
-    glUniform3f(glGetUniformLocation(shader_program_, name), vector.x, vector.y, vector.z);
+    glUniform3f(FindUniform(name, 0), vector.x, vector.y, vector.z);
 }
 
 
 void Shader::SetUniform4f(const GLchar *name, const glm::vec4 &vector)
 {
 
-    glUniform4f(glGetUniformLocation(shader_program_, name), vector.x, vector.y, vector.z, vector.w);
+    glUniform4f(FindUniform(name, 0), vector.x, vector.y, vector.z, vector.w);
 }
 
 
 void Shader::SetUniformMat4(const GLchar *name, const glm::mat4 &matrix)
 {
 
-    glUniformMatrix4fv(glGetUniformLocation(shader_program_, name), 1, GL_FALSE, glm::value_ptr(matrix));
+    glUniformMatrix4fv(FindUniform(name, 0), 1, GL_FALSE, glm::value_ptr(matrix));
 }
 
 
 Shader::~Shader() 
 {
 
+    // Never initialized (e.g., headless runs have no OpenGL context)
+    if (shader_program_ == 0) {
+        return;
+    }
+
     glDeleteProgram(shader_program_);
 }
 
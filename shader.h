@@ -4,9 +4,60 @@
 #define GLEW_STATIC
 #include <GL/glew.h>
 #include <glm/glm.hpp>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace game {
 
+    // Fixed attribute locations: Init() binds these names to them before
+    // linking, so vertex array objects can be set up without a shader
+    enum AttributeSlot {
+        ATTRIB_VERTEX,                  // "vertex"
+        ATTRIB_DIR,                     // "dir"
+        ATTRIB_PHASE,                   // "t"
+        ATTRIB_UV,                      // "uv"
+        ATTRIB_INSTANCE_TRANSFORM,      // "instance_transform"
+        ATTRIB_INSTANCE_UV_RECT,        // "instance_uv_rect"
+        ATTRIB_INSTANCE_TINT,           // "instance_tint"
+        ATTRIB_INSTANCE_LAYER_DEPTH,    // "instance_layer_depth"
+        ATTRIB_PARTICLE,                // "particle"
+        ATTRIB_PARTICLE_AGE,            // "particle_age"
+        ATTRIB_PARTICLE_SIZE,           // "size"
+        NUM_ATTRIBUTE_SLOTS
+    };
+
+    // Fixed uniform block binding points: Init() binds blocks with these
+    // names to them, so a buffer bound there is seen by every program
+    enum UniformBlockBinding {
+        BLOCK_FRAME,                    // "Frame", see FrameData
+        BLOCK_EMITTERS,                 // "Emitters", see EmitterData
+        NUM_UNIFORM_BLOCKS
+    };
+
+    // Handle to a uniform, typed by the value it holds
+    // Get one once with Shader::GetUniform and keep it; -1 if the uniform
+    // is not in the program, in which case setting it does nothing
+    template <typename T>
+    struct Uniform {
+        GLint location = -1;
+    };
+
+    // Handle to a vertex attribute, -1 if it is not in the program
+    struct Attribute {
+        GLint location = -1;
+        inline bool IsValid(void) const { return location >= 0; }
+    };
+
+    // OpenGL type expected for each uniform handle type
+    template <typename T> struct UniformType;
+    template <> struct UniformType<int> { static const GLenum value = GL_INT; };
+    template <> struct UniformType<float> { static const GLenum value = GL_FLOAT; };
+    template <> struct UniformType<glm::vec2> { static const GLenum value = GL_FLOAT_VEC2; };
+    template <> struct UniformType<glm::vec3> { static const GLenum value = GL_FLOAT_VEC3; };
+    template <> struct UniformType<glm::vec4> { static const GLenum value = GL_FLOAT_VEC4; };
+    template <> struct UniformType<glm::mat4> { static const GLenum value = GL_FLOAT_MAT4; };
+
     // A class that stores a pair of vertex, fragment shaders
     class Shader {
 
@@ -15,12 +66,42 @@ namespace game {
             ~Shader();
 
             // Initialize shader with source files
-            void Init(const char *vertPath, const char *fragPath);
+            // A program that only writes transform feedback can leave out
+            // the fragment shader (fragPath NULL) and names the vertex
+            // shader outputs to capture, interleaved in the given order
+            void Init(const char *vertPath, const char *fragPath, const char **feedback_varyings = NULL, int feedback_count = 0);
+
+            // Initialize a compute shader program (GL 4.3) from a source file
+            void InitCompute(const char *compPath);
 
             // Enable or disable this specific shader
             void Enable();
             void Disable();
 
+            // Look up a uniform or attribute in the table built by Init()
+            // Warns (once per name) if it is missing or has another type
+            template <typename T>
+            inline Uniform<T> GetUniform(const GLchar *name) {
+                Uniform<T> uniform;
+                uniform.location = FindUniform(name, UniformType<T>::value);
+                return uniform;
+            }
+            Attribute GetAttribute(const GLchar *name);
+
+            // Set a uniform through its handle (the shader must be enabled)
+            void Set(Uniform<int> uniform, int value);
+            void Set(Uniform<float> uniform, float value);
+            void Set(Uniform<glm::vec2> uniform, const glm::vec2 &vector);
+            void Set(Uniform<glm::vec3> uniform, const glm::vec3 &vector);
+            void Set(Uniform<glm::vec4> uniform, const glm::vec4 &vector);
+            void Set(Uniform<glm::mat4> uniform, const glm::mat4 &matrix);
+
+            // Set the first count elements of a uniform array
+            void Set(Uniform<glm::vec4> uniform, const glm::vec4 *vectors, int count);
+
+            // The SetUniform* functions below look the name up in the same
+            // table, so they never ask the driver, but hot code should hold handles
+
             // Sets a uniform integer variable in your shader program to a value
             void SetUniform1i(const GLchar *name, int value);
 
@@ -43,9 +124,31 @@ namespace game {
             inline GLuint GetShaderProgram(void) { return shader_program_; }
 
         private:
+            // What the program reports about one of its uniforms or attributes
+            struct Variable {
+                GLint location;
+                GLenum type;
+            };
+
+            // Fill the tables with every active uniform and attribute
+            void Reflect(void);
+
+            // Location of a uniform, checking its type unless expected_type is 0
+            GLint FindUniform(const GLchar *name, GLenum expected_type);
+
+            // Print a warning the first time a name is reported
+            void Warn(const std::string &name, const std::string &message);
+
             // Reference to shader program
             GLuint shader_program_;
 
+            // Active uniforms and attributes by name
+            std::unordered_map<std::string, Variable> uniforms_;
+            std::unordered_map<std::string, Variable> attributes_;
+
+            // Names already warned about
+            std::unordered_set<std::string> warned_;
+
     }; // class Shader
 } // namespace game
 
@@ -0,0 +1,26 @@
+#include "sim_clock.h"
+
+namespace game {
+
+// Simulation time since the start of the run
+static SimClock::time_point sim_now_g;
+
+
+SimClock::time_point SimClock::now(void) noexcept
+{
+    return sim_now_g;
+}
+
+
+void SimClock::Advance(double seconds)
+{
+    sim_now_g += std::chrono::duration_cast<duration>(std::chrono::duration<double>(seconds));
+}
+
+
+void SimClock::Reset(time_point time)
+{
+    sim_now_g = time;
+}
+
+} // namespace game
@@ -0,0 +1,34 @@
+#ifndef SIM_CLOCK_H_
+#define SIM_CLOCK_H_
+
+#include <chrono>
+
+namespace game {
+
+    // A std::chrono clock that only moves when the simulation advances
+    // Gameplay timers (lifetimes, fire rates, spawn waves) use this instead
+    // of the system clock, so a run with the same seed and inputs plays out
+    // the same way no matter how fast the ticks are executed
+    class SimClock {
+
+        public:
+            typedef std::chrono::nanoseconds duration;
+            typedef duration::rep rep;
+            typedef duration::period period;
+            typedef std::chrono::time_point<SimClock> time_point;
+            static const bool is_steady = true;
+
+            // Current simulation time
+            static time_point now(void) noexcept;
+
+            // Move simulation time forward by one tick
+            static void Advance(double seconds);
+
+            // Jump to a given time (start of a run, or a restored snapshot)
+            static void Reset(time_point time = time_point());
+
+    }; // class SimClock
+
+} // namespace game
+
+#endif // SIM_CLOCK_H_
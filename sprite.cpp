@@ -1,14 +1,24 @@
 #include <iostream>
 #include <string>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include "sprite.h"
+#include "vertex_format.h"
 
 namespace game {
 
+// Attributes of a QuadVertex
+static const VertexAttribute quad_attributes_g[] = {
+    { ATTRIB_VERTEX, 2, GL_SHORT, GL_TRUE, offsetof(QuadVertex, position) },
+    { ATTRIB_UV, 2, GL_UNSIGNED_SHORT, GL_TRUE, offsetof(QuadVertex, uv) }
+};
+static const int num_quad_attributes_g = sizeof(quad_attributes_g) / sizeof(VertexAttribute);
+
 Sprite::Sprite(void) : Geometry()
 {
     // Initialize variables with default values
+    vao_ = 0;
     vbo_ = 0;
     ebo_ = 0;
     size_ = 0;
@@ -19,19 +29,24 @@ void Sprite::CreateGeometry(void){
 
     // The face of the square is defined by four vertices and two triangles
 
-    // Number of attributes for vertices and faces
-    // const int vertex_att = 7;  // 7 attributes per vertex: 2D (or 3D) position (2), RGB color (3), 2D texture coordinates (2)
-    // const int face_att = 3; // Vertex indices (3)
-
-    GLfloat vertex[]  = {
-        // Four vertices of a square
-        // Position      Color                Texture coordinates
-        -0.5f,  0.5f,    1.0f, 0.0f, 0.0f,    0.0f, 0.0f, // Top-left
-         0.5f,  0.5f,    0.0f, 1.0f, 0.0f,    1.0f, 0.0f, // Top-right
-         0.5f, -0.5f,    0.0f, 0.0f, 1.0f,    1.0f, 1.0f, // Bottom-right
-        -0.5f, -0.5f,    1.0f, 1.0f, 1.0f,    0.0f, 1.0f  // Bottom-left
+    // Four vertices of a square: position and texture coordinates
+    // (the colour the vertices used to carry was never read)
+    GLfloat corners[] = {
+        -0.5f,  0.5f,    0.0f, 0.0f, // Top-left
+         0.5f,  0.5f,    1.0f, 0.0f, // Top-right
+         0.5f, -0.5f,    1.0f, 1.0f, // Bottom-right
+        -0.5f, -0.5f,    0.0f, 1.0f  // Bottom-left
     };
 
+    // Stored packed: snorm16 positions and unorm16 uvs
+    QuadVertex vertex[4];
+    for (int i = 0; i < 4; i++) {
+        vertex[i].position[0] = glm::packSnorm1x16(corners[i * 4 + 0]);
+        vertex[i].position[1] = glm::packSnorm1x16(corners[i * 4 + 1]);
+        vertex[i].uv[0] = glm::packUnorm1x16(corners[i * 4 + 2]);
+        vertex[i].uv[1] = glm::packUnorm1x16(corners[i * 4 + 3]);
+    }
+
     // Two triangles referencing the vertices
     GLuint face[] = {
         0, 1, 2, // t1
@@ -50,34 +65,25 @@ void Sprite::CreateGeometry(void){
 
     // Set number of elements in array buffer (6 in this case)
     size_ = sizeof(face) / sizeof(GLuint);
+
+    // Record the attribute layout once
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+    SetAttributes();
+    glBindVertexArray(0);
 }
 
 
-void Sprite::SetGeometry(GLuint shader_program)
+void Sprite::SetAttributes(void)
 {
 
-    // No blending
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LESS);
-    glDisable(GL_BLEND);
-
     // Bind buffers
     glBindBuffer(GL_ARRAY_BUFFER, vbo_);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo_);
 
     // Set attributes for shaders
     // Should be consistent with how we created the buffers for the square
-    GLint vertex_att = glGetAttribLocation(shader_program, "vertex");
-    glVertexAttribPointer(vertex_att, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), 0);
-    glEnableVertexAttribArray(vertex_att);
-
-    GLint color_att = glGetAttribLocation(shader_program, "color");
-    glVertexAttribPointer(color_att, 3, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void *)(2 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(color_att);
-
-    GLint tex_att = glGetAttribLocation(shader_program, "uv");
-    glVertexAttribPointer(tex_att, 2, GL_FLOAT, GL_FALSE, 7 * sizeof(GLfloat), (void *)(5 * sizeof(GLfloat)));
-    glEnableVertexAttribArray(tex_att);
+    SetVertexAttributes(quad_attributes_g, num_quad_attributes_g, sizeof(QuadVertex));
 }
 
 } // namespace game
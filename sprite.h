@@ -15,8 +15,8 @@ namespace game {
             // Create the geometry (called once)
             void CreateGeometry(void);
 
-            // Use the geometry
-            void SetGeometry(GLuint shader_program);
+            // Point the attribute slots at the buffers
+            void SetAttributes(void);
 
     }; // class Sprite
 } // namespace game
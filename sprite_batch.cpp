@@ -0,0 +1,93 @@
+#include <cstddef>
+
+#include "sprite_batch.h"
+#include "vertex_format.h"
+
+namespace game {
+
+// Instance attributes and where they are in SpriteInstance
+// The uv rect stays a float: the background repeats its texture far past 1
+static const VertexAttribute instance_attributes_g[] = {
+    { ATTRIB_INSTANCE_TRANSFORM, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, position) },
+    { ATTRIB_INSTANCE_UV_RECT, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, uv_rect) },
+    { ATTRIB_INSTANCE_TINT, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(SpriteInstance, tint) },
+    { ATTRIB_INSTANCE_LAYER_DEPTH, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, layer) }
+};
+static const int num_instance_attributes_g = sizeof(instance_attributes_g) / sizeof(VertexAttribute);
+
+
+SpriteBatch::SpriteBatch(void)
+{
+    quad_ = nullptr;
+    vao_ = 0;
+    attribute_buffer_ = 0;
+    attribute_offset_ = 0;
+}
+
+
+SpriteBatch::~SpriteBatch()
+{
+    // Never initialized (e.g., headless runs have no OpenGL context)
+    if (vao_ == 0) {
+        return;
+    }
+
+    glDeleteVertexArrays(1, &vao_);
+}
+
+
+void SpriteBatch::Init(Geometry *quad)
+{
+    quad_ = quad;
+
+    // Room for a few thousand sprites a frame; it grows if needed
+    instance_stream_.Init(GL_ARRAY_BUFFER, 4096 * sizeof(SpriteInstance));
+
+    // The quad's vertices, plus the instance attributes that advance once per sprite
+    glGenVertexArrays(1, &vao_);
+    glBindVertexArray(vao_);
+    quad_->SetAttributes();
+    SetInstanceAttributes(0);
+    glBindVertexArray(0);
+}
+
+
+void SpriteBatch::SetInstanceAttributes(size_t offset)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instance_stream_.GetBuffer());
+    SetVertexAttributes(instance_attributes_g, num_instance_attributes_g, sizeof(SpriteInstance), offset, 1);
+    attribute_buffer_ = instance_stream_.GetBuffer();
+    attribute_offset_ = offset;
+}
+
+
+SpriteInstance *SpriteBatch::Begin(size_t count)
+{
+    return (SpriteInstance *)instance_stream_.Begin(count * sizeof(SpriteInstance));
+}
+
+
+void SpriteBatch::End(void)
+{
+    instance_stream_.End();
+}
+
+
+void SpriteBatch::Draw(size_t first, size_t count)
+{
+    // The stream moves between partitions (and may be recreated larger)
+    glBindVertexArray(vao_);
+    size_t offset = instance_stream_.GetOffset() + first * sizeof(SpriteInstance);
+    if (instance_stream_.GetBuffer() != attribute_buffer_ || offset != attribute_offset_) {
+        SetInstanceAttributes(offset);
+    }
+    glDrawElementsInstanced(GL_TRIANGLES, quad_->GetSize(), GL_UNSIGNED_INT, 0, (GLsizei)count);
+}
+
+
+void SpriteBatch::Report(void)
+{
+    instance_stream_.Report("Sprite instance");
+}
+
+} // namespace game
@@ -0,0 +1,68 @@
+#ifndef SPRITE_BATCH_H_
+#define SPRITE_BATCH_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "geometry.h"
+#include "stream_buffer.h"
+
+namespace game {
+
+    // Everything needed to draw one sprite, stored once per instance
+    // The layout must match the instance attributes in sprite_vertex_shader.glsl
+    struct SpriteInstance {
+        glm::vec2 position;
+        float angle;
+        float scale;
+        glm::vec4 uv_rect;      // Offset (xy) and size (zw) of the texture area shown
+        GLuint tint;            // Multiplied with the texture colour, RGBA unorm8 (glm::packUnorm4x8)
+        float layer;            // Layer when the texture is an array
+        float depth;            // Set by the render queue from the submission order
+    };
+
+    // Draws runs of sprites with one instanced call each: the shared unit
+    // quad plus a stream buffer holding a SpriteInstance per sprite
+    // The render queue decides the runs and sets the shader and texture
+    class SpriteBatch {
+
+        public:
+            SpriteBatch(void);
+            ~SpriteBatch();
+
+            // Use the given unit quad (needs an OpenGL context and the
+            // quad's geometry to be created)
+            void Init(Geometry *quad);
+
+            // Get room for this frame's count instances, once per frame
+            // Fill it, then call End() before drawing
+            SpriteInstance *Begin(size_t count);
+            void End(void);
+
+            // Draw count of this frame's instances starting at first
+            void Draw(size_t first, size_t count);
+
+            // Print the stream buffer's statistics
+            void Report(void);
+
+        private:
+            // Point the instance attributes at the given byte offset of the instance buffer
+            void SetInstanceAttributes(size_t offset);
+
+            Geometry *quad_;
+
+            // The quad's attributes plus the instance buffer's, in one vertex array
+            GLuint vao_;
+            StreamBuffer instance_stream_;
+
+            // Buffer and byte offset the instance attributes currently point at
+            GLuint attribute_buffer_;
+            size_t attribute_offset_;
+
+    }; // class SpriteBatch
+
+} // namespace game
+
+#endif // SPRITE_BATCH_H_
@@ -4,17 +4,15 @@
 // Attributes passed from the vertex shader
 in vec4 color_interp;
 in vec2 uv_interp;
+flat in float layer_interp;
 
-// Texture sampler
-uniform sampler2D onetex;
-uniform float x = 1.0; //added uniform float variable
+// Texture sampler: the atlas pages, or a single layer for other textures
+uniform sampler2DArray onetex;
 
 void main()
 {
-    // Sample texture
-    
-
-    vec4 color = texture2D(onetex, vec2(uv_interp.x * x, uv_interp.y * x)); // uniform float x can be set from game_object.cpp in my code when calling shader on a game_object
+    // Sample texture (the uv rect already repeats the background many times over)
+    vec4 color = texture(onetex, vec3(uv_interp, layer_interp)) * color_interp;
 
     // Assign color to fragment
     gl_FragColor = vec4(color.r, color.g, color.b, color.a);
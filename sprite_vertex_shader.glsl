@@ -1,26 +1,41 @@
 // Source code of vertex shader
 #version 130
+#extension GL_ARB_uniform_buffer_object : require
 
-// Vertex buffer
+// Vertex buffer (the shared unit quad)
 in vec2 vertex;
-in vec3 color;
 in vec2 uv;
 
-// Uniform (global) buffer
-uniform mat4 transformation_matrix;
-uniform mat4 view_matrix;
+// Instance buffer (one record per sprite, see SpriteInstance)
+in vec4 instance_transform;   // Position (xy), angle (z), scale (w)
+in vec4 instance_uv_rect;     // Offset (xy) and size (zw) of the texture area
+in vec4 instance_tint;
+in vec2 instance_layer_depth; // Texture layer (x), depth from draw order (y)
+
+// Per-frame values shared by all programs (see FrameData)
+layout(std140) uniform Frame {
+    mat4 view_matrix;
+    vec4 camera; // Position (xy), zoom (z), time (w)
+};
 
 // Attributes forwarded to the fragment shader
 out vec4 color_interp;
 out vec2 uv_interp;
+flat out float layer_interp;
 
 void main()
 {
-    // Transform vertex
-    vec4 vertex_pos = vec4(vertex, 0.0, 1.0);
-    gl_Position = view_matrix * transformation_matrix * vertex_pos;
+    // Scale, rotate and translate the vertex (same as translation * rotation * scaling)
+    float c = cos(instance_transform.z);
+    float s = sin(instance_transform.z);
+    vec2 world_pos = mat2(c, s, -s, c) * (vertex * instance_transform.w) + instance_transform.xy;
+    gl_Position = view_matrix * vec4(world_pos, 0.0, 1.0);
+
+    // Earlier sprites win the depth test, as if drawn one by one in order
+    gl_Position.z = instance_layer_depth.y * gl_Position.w;
     
     // Pass attributes to fragment shader
-    color_interp = vec4(color, 1.0);
-    uv_interp = uv;
+    color_interp = instance_tint;
+    uv_interp = instance_uv_rect.xy + uv * instance_uv_rect.zw;
+    layer_interp = instance_layer_depth.x;
 }
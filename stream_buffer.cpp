@@ -0,0 +1,174 @@
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <algorithm>
+#include <chrono>
+
+#include "stream_buffer.h"
+
+namespace game {
+
+StreamBuffer::StreamBuffer(void)
+{
+    target_ = GL_ARRAY_BUFFER;
+    buffer_ = 0;
+    persistent_ = false;
+    partition_size_ = 0;
+    mapped_ = nullptr;
+    partition_ = 0;
+    offset_ = 0;
+    for (int i = 0; i < NUM_PARTITIONS; i++) {
+        fences_[i] = 0;
+    }
+    frames_ = 0;
+    stalls_ = 0;
+    stall_time_ = 0.0;
+}
+
+
+StreamBuffer::~StreamBuffer()
+{
+    // Never initialized (e.g., headless runs have no OpenGL context)
+    if (buffer_ == 0) {
+        return;
+    }
+
+    Release();
+}
+
+
+void StreamBuffer::Init(GLenum target, size_t partition_size)
+{
+    target_ = target;
+    persistent_ = (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage);
+    Allocate(partition_size);
+}
+
+
+void StreamBuffer::Allocate(size_t partition_size)
+{
+    partition_size_ = partition_size;
+    partition_ = 0;
+
+    glGenBuffers(1, &buffer_);
+    glBindBuffer(target_, buffer_);
+    if (persistent_) {
+        // Coherent, so writes need no explicit flush before drawing
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(target_, NUM_PARTITIONS * partition_size_, NULL, flags);
+        mapped_ = (char *)glMapBufferRange(target_, 0, NUM_PARTITIONS * partition_size_, flags);
+        if (!mapped_) {
+            throw(std::runtime_error(std::string("Could not map the stream buffer")));
+        }
+    }
+    else {
+        glBufferData(target_, partition_size_, NULL, GL_STREAM_DRAW);
+    }
+    glBindBuffer(target_, 0);
+}
+
+
+void StreamBuffer::Release(void)
+{
+    for (int i = 0; i < NUM_PARTITIONS; i++) {
+        if (fences_[i]) {
+            glDeleteSync(fences_[i]);
+            fences_[i] = 0;
+        }
+    }
+
+    // Deleting the buffer also unmaps it; the driver keeps the storage
+    // until draws already issued are done with it
+    glDeleteBuffers(1, &buffer_);
+    buffer_ = 0;
+    mapped_ = nullptr;
+}
+
+
+void StreamBuffer::WaitForPartition(int partition)
+{
+    GLsync fence = fences_[partition];
+    if (!fence) {
+        return;
+    }
+
+    // Only a stall if the GPU has not finished with it already
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    if (result == GL_TIMEOUT_EXPIRED) {
+        stalls_++;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        do {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        } while (result == GL_TIMEOUT_EXPIRED);
+        stall_time_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    glDeleteSync(fence);
+    fences_[partition] = 0;
+}
+
+
+void *StreamBuffer::Begin(size_t size)
+{
+    frames_++;
+
+    // Everything issued so far, including the draws reading the previous
+    // frame's data, comes before this fence
+    if (persistent_ && frames_ > 1) {
+        fences_[partition_] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        partition_ = (partition_ + 1) % NUM_PARTITIONS;
+    }
+
+    if (size > partition_size_) {
+        Release();
+        Allocate(std::max(size, 2 * partition_size_));
+    }
+
+    if (persistent_) {
+        WaitForPartition(partition_);
+        offset_ = partition_ * partition_size_;
+        return mapped_ + offset_;
+    }
+
+    // Orphan the old storage, which draws in flight may still read, and
+    // write into new storage without waiting for them
+    glBindBuffer(target_, buffer_);
+    glBufferData(target_, partition_size_, NULL, GL_STREAM_DRAW);
+    mapped_ = (char *)glMapBufferRange(target_, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (!mapped_) {
+        throw(std::runtime_error(std::string("Could not map the stream buffer")));
+    }
+    offset_ = 0;
+    return mapped_;
+}
+
+
+void StreamBuffer::End(void)
+{
+    // A buffer must not be mapped while drawing, unless mapped persistently
+    if (!persistent_) {
+        glBindBuffer(target_, buffer_);
+        glUnmapBuffer(target_);
+        mapped_ = nullptr;
+    }
+}
+
+
+void StreamBuffer::Report(const char *name)
+{
+    if (frames_ == 0) {
+        return;
+    }
+
+    if (persistent_) {
+        std::cout << name << " stream (persistent, " << NUM_PARTITIONS << " x " << partition_size_ << " bytes): "
+            << frames_ << " frames, " << stalls_ << " stalls, "
+            << stall_time_ * 1000.0 << " ms waiting for the GPU" << std::endl;
+    }
+    else {
+        std::cout << name << " stream (orphaning, " << partition_size_ << " bytes): "
+            << frames_ << " frames" << std::endl;
+    }
+}
+
+} // namespace game
@@ -0,0 +1,78 @@
+#ifndef STREAM_BUFFER_H_
+#define STREAM_BUFFER_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <cstddef>
+
+namespace game {
+
+    // A buffer for data written by the CPU every frame and read by the GPU
+    // in the same frame (instance records, dynamic vertices)
+    //
+    // With GL 4.4 / ARB_buffer_storage the buffer is mapped once, for good,
+    // and split in three partitions used in turn. A fence after each
+    // frame's draws tells when the GPU is done with a partition, so the CPU
+    // only waits if it gets three frames ahead; those waits are counted as
+    // stalls. Older contexts orphan the buffer each frame instead and let
+    // the driver hand out fresh memory
+    //
+    // Writers get a pointer into the buffer and fill it directly
+    class StreamBuffer {
+
+        public:
+            StreamBuffer(void);
+            ~StreamBuffer();
+
+            // Create the buffer for the given target, with room for
+            // partition_size bytes a frame (needs an OpenGL context)
+            void Init(GLenum target, size_t partition_size);
+
+            // Start this frame's writes: returns room for size bytes
+            // The buffer is recreated larger if size does not fit, so call
+            // GetBuffer() afterwards rather than keeping the old name
+            void *Begin(size_t size);
+
+            // Finish the writes; draws reading them may follow
+            void End(void);
+
+            // Buffer name and byte offset of the data from the last Begin
+            inline GLuint GetBuffer(void) const { return buffer_; }
+            inline size_t GetOffset(void) const { return offset_; }
+
+            // Print the number of frames and stalls
+            void Report(const char *name);
+
+        private:
+            enum { NUM_PARTITIONS = 3 };
+
+            // (Re)create the buffer and its mapping
+            void Allocate(size_t partition_size);
+            void Release(void);
+
+            // Wait for the GPU to finish with a partition
+            void WaitForPartition(int partition);
+
+            GLenum target_;
+            GLuint buffer_;
+            bool persistent_;
+            size_t partition_size_;
+
+            // Persistent mapping of the whole buffer, or the current
+            // frame's mapping when orphaning
+            char *mapped_;
+
+            int partition_;
+            size_t offset_;
+            GLsync fences_[NUM_PARTITIONS];
+
+            // Statistics
+            long frames_;
+            long stalls_;
+            double stall_time_;
+
+    }; // class StreamBuffer
+
+} // namespace game
+
+#endif // STREAM_BUFFER_H_
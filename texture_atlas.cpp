@@ -0,0 +1,151 @@
+#include <stdexcept>
+#include <ios>
+#include <algorithm>
+#include <SOIL/SOIL.h>
+
+#include "texture_atlas.h"
+
+// Dear ImGui compiles its own static copy, so this one is static as well
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace game {
+
+TextureAtlas::TextureAtlas(int page_size, int padding)
+{
+    page_size_ = page_size;
+    padding_ = padding;
+    texture_ = 0;
+    page_count_ = 0;
+}
+
+
+TextureAtlas::~TextureAtlas()
+{
+    for (int i = 0; i < images_.size(); i++) {
+        SOIL_free_image_data(images_[i].pixels);
+    }
+
+    // Never built (e.g., headless runs have no OpenGL context)
+    if (texture_ == 0) {
+        return;
+    }
+
+    glDeleteTextures(1, &texture_);
+}
+
+
+void TextureAtlas::Add(GLuint key, const std::string &path)
+{
+    Image image;
+    image.key = key;
+    image.pixels = SOIL_load_image(path.c_str(), &image.width, &image.height, 0, SOIL_LOAD_RGBA);
+    if (!image.pixels) {
+        throw(std::ios_base::failure(std::string("Could not load texture ") + path));
+    }
+    images_.push_back(image);
+}
+
+
+void TextureAtlas::Blit(const Image &image, int x, int y, std::vector<unsigned char> &page)
+{
+    // Every pixel of the padded rectangle takes the colour of the nearest
+    // image pixel, which extrudes the edges into the padding
+    for (int row = -padding_; row < image.height + padding_; row++) {
+        int src_row = std::min(std::max(row, 0), image.height - 1);
+        for (int col = -padding_; col < image.width + padding_; col++) {
+            int src_col = std::min(std::max(col, 0), image.width - 1);
+            const unsigned char *src = &image.pixels[(src_row * image.width + src_col) * 4];
+            unsigned char *dst = &page[((y + row) * page_size_ + (x + col)) * 4];
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst[3] = src[3];
+        }
+    }
+}
+
+
+void TextureAtlas::Build(void)
+{
+    // Padded rectangles to pack, id is the index in images_
+    std::vector<stbrp_rect> rects(images_.size());
+    for (int i = 0; i < images_.size(); i++) {
+        rects[i].id = i;
+        rects[i].w = images_[i].width + 2 * padding_;
+        rects[i].h = images_[i].height + 2 * padding_;
+        rects[i].was_packed = 0;
+        if (rects[i].w > page_size_ || rects[i].h > page_size_) {
+            throw(std::runtime_error(std::string("Texture too large for an atlas page")));
+        }
+    }
+
+    std::vector<stbrp_node> nodes(page_size_);
+    std::vector<std::vector<unsigned char> > pages;
+    float texel = 1.0f / page_size_;
+    glGenTextures(1, &texture_);
+
+    // Fill one page at a time with whatever still has to be packed
+    while (!rects.empty()) {
+        stbrp_context context;
+        stbrp_init_target(&context, page_size_, page_size_, nodes.data(), (int)nodes.size());
+        stbrp_pack_rects(&context, rects.data(), (int)rects.size());
+
+        int layer = (int)pages.size();
+        pages.push_back(std::vector<unsigned char>(page_size_ * page_size_ * 4, 0));
+
+        std::vector<stbrp_rect> left;
+        for (int i = 0; i < rects.size(); i++) {
+            if (!rects[i].was_packed) {
+                left.push_back(rects[i]);
+                continue;
+            }
+
+            const Image &image = images_[rects[i].id];
+            int x = rects[i].x + padding_;
+            int y = rects[i].y + padding_;
+            Blit(image, x, y, pages[layer]);
+
+            AtlasRegion region;
+            region.texture = texture_;
+            region.layer = (float)layer;
+            region.uv_rect = glm::vec4(x * texel, y * texel, image.width * texel, image.height * texel);
+            regions_[image.key] = region;
+        }
+        rects = left;
+    }
+
+    // One layer per page
+    page_count_ = (int)pages.size();
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture_);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, page_size_, page_size_, page_count_, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    for (int layer = 0; layer < page_count_; layer++) {
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, page_size_, page_size_, 1, GL_RGBA, GL_UNSIGNED_BYTE, pages[layer].data());
+    }
+
+    // Edges are already padded, so clamp instead of repeating
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    // The pixels now live on the GPU
+    for (int i = 0; i < images_.size(); i++) {
+        SOIL_free_image_data(images_[i].pixels);
+    }
+    images_.clear();
+}
+
+
+bool TextureAtlas::Find(GLuint key, AtlasRegion &region) const
+{
+    std::unordered_map<GLuint, AtlasRegion>::const_iterator it = regions_.find(key);
+    if (it == regions_.end()) {
+        return false;
+    }
+    region = it->second;
+    return true;
+}
+
+} // namespace game
@@ -0,0 +1,74 @@
+#ifndef TEXTURE_ATLAS_H_
+#define TEXTURE_ATLAS_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+namespace game {
+
+    // Where a packed image ended up: the array texture, the page's layer
+    // in it and the uv rect on that page (offset in xy, size in zw)
+    struct AtlasRegion {
+        GLuint texture;
+        float layer;
+        glm::vec4 uv_rect;
+    };
+
+    // Packs many small sprite images into a few large pages at load time,
+    // so sprites that used separate textures can share one bind and one batch
+    // The pages are the layers of one GL_TEXTURE_2D_ARRAY, so switching
+    // between images (e.g. ship variants) never needs another bind, even
+    // across pages
+    //
+    // Each image is added under a key (the texture name the game objects
+    // already hold), so code that stores textures does not need to change
+    // Images that must repeat (e.g. the tiled background) can't be packed
+    class TextureAtlas {
+
+        public:
+            // Pages are square; padding is the border of copied edge pixels
+            // around every image, so filtering never picks up a neighbour
+            TextureAtlas(int page_size = 2048, int padding = 2);
+            ~TextureAtlas();
+
+            // Load an image file to be packed under the given key
+            void Add(GLuint key, const std::string &path);
+
+            // Pack everything added so far into pages and upload them
+            // Needs an OpenGL context; throws if an image can't fit on a page
+            void Build(void);
+
+            // Look up where a key was packed, false if it is not in the atlas
+            bool Find(GLuint key, AtlasRegion &region) const;
+
+            inline int GetPageCount(void) const { return page_count_; }
+
+        private:
+            struct Image {
+                GLuint key;
+                int width, height;
+                unsigned char *pixels;
+            };
+
+            // Copy an image and its extruded edges into a page's pixels
+            void Blit(const Image &image, int x, int y, std::vector<unsigned char> &page);
+
+            int page_size_;
+            int padding_;
+
+            // Images waiting for Build()
+            std::vector<Image> images_;
+
+            GLuint texture_;
+            int page_count_;
+            std::unordered_map<GLuint, AtlasRegion> regions_;
+
+    }; // class TextureAtlas
+
+} // namespace game
+
+#endif // TEXTURE_ATLAS_H_
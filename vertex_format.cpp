@@ -0,0 +1,16 @@
+#include "vertex_format.h"
+
+namespace game {
+
+void SetVertexAttributes(const VertexAttribute *attributes, int count, GLsizei stride, size_t base, GLuint divisor)
+{
+    for (int i = 0; i < count; i++) {
+        const VertexAttribute &attribute = attributes[i];
+        glVertexAttribPointer(attribute.slot, attribute.size, attribute.type, attribute.normalized, stride,
+            (void *)(base + attribute.offset));
+        glEnableVertexAttribArray(attribute.slot);
+        glVertexAttribDivisor(attribute.slot, divisor);
+    }
+}
+
+} // namespace game
@@ -0,0 +1,56 @@
+#ifndef VERTEX_FORMAT_H_
+#define VERTEX_FORMAT_H_
+
+#define GLEW_STATIC
+#include <GL/glew.h>
+#include <cstddef>
+
+#include "shader.h"
+
+namespace game {
+
+    // Packed vertex records. Values in [-1, 1] or [0, 1] are stored as
+    // normalized integers (snorm/unorm), which the attribute setup turns
+    // back into floats, so the shaders read the same values as before
+    // Fill them with glm::packSnorm1x16, packUnorm1x16 and packUnorm1x8
+
+    // A corner of the unit quad (8 bytes instead of 28)
+    struct QuadVertex {
+        GLshort position[2];    // snorm16
+        GLushort uv[2];         // unorm16
+    };
+
+    // A particle vertex when every vertex is stored (16 bytes instead of 28)
+    struct ParticleVertex {
+        GLshort position[2];    // snorm16
+        GLshort dir[2];         // snorm16
+        GLushort uv[2];         // unorm16
+        GLubyte phase;          // unorm8
+        GLubyte padding[3];     // Keeps records on 4 byte boundaries
+    };
+
+    // A particle of the instanced layout (8 bytes instead of 16)
+    struct ParticleInstance {
+        GLshort dir[2];         // snorm16
+        GLubyte phase;          // unorm8
+        GLubyte size;           // unorm8
+        GLubyte padding[2];
+    };
+
+    // Where one attribute is in a record and how it is stored
+    struct VertexAttribute {
+        AttributeSlot slot;
+        GLint size;             // Number of components
+        GLenum type;            // GL_FLOAT, GL_SHORT, GL_UNSIGNED_BYTE, ...
+        GLboolean normalized;   // Integers read as [-1, 1] (signed) or [0, 1]
+        size_t offset;
+    };
+
+    // Point and enable the attributes of records of stride bytes in the
+    // bound GL_ARRAY_BUFFER, starting base bytes in; a divisor of 1
+    // advances them once per instance instead of once per vertex
+    void SetVertexAttributes(const VertexAttribute *attributes, int count, GLsizei stride, size_t base = 0, GLuint divisor = 0);
+
+} // namespace game
+
+#endif // VERTEX_FORMAT_H_